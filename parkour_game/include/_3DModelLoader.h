@@ -3,6 +3,9 @@
 
 #include <_common.h>
 #include <_textureLoader.h>
+#include <vector>
+
+class _md2Instance;
 
 
 
@@ -91,6 +94,8 @@ struct md2_model_t
   int *glcmds;
 
   GLuint tex_id;
+
+  void *arena;        /* one allocation behind every pointer above */
 };
 
 /* Table of precalculated normals */
@@ -117,27 +122,49 @@ class _3DModelLoader
           struct md2_glcmd_t *packet;
           struct md2_model_t md2file;
 
-          int ReadMD2Model (const char *filename, struct md2_model_t *mdl);
+          int ReadMD2Model (const char *filename, struct md2_model_t *mdl);       //file I/O only, no GL calls
+          int ParseMD2 (const unsigned char *data, size_t size, struct md2_model_t *mdl);  //validate a file image and copy it into one arena
+          void loadSkins (struct md2_model_t *mdl);                               //GL thread: skin textures
           void RenderFrame (int n, const struct md2_model_t *mdl);
           void RenderFrameItpWithGLCmds (int n, float interp, const struct md2_model_t *mdl);
+          void RenderFrameItpWithVBO (int n, float interp, const struct md2_model_t *mdl); //one indexed draw, positions/normals streamed
+          void InterpolateFrames (const struct md2_frame_t *a, const struct md2_frame_t *b, float interp, float *out);     //scalar, one component at a time
+          void InterpolateFramesSSE (const struct md2_frame_t *a, const struct md2_frame_t *b, float interp, float *out);  //same output, one vertex per SSE op
+          void BenchmarkInterpolation (int iterations);                          //scalar vs SSE over every frame pair, prints timings
+          void BuildIndexedMesh (const struct md2_model_t *mdl);                  //glcmds -> indexed triangles, no GL calls
+          void UploadBuffers();                                                   //GL thread: static IBO/texcoords, dynamic VBO
           void Animate (int start, int end, int *frame, float *interp);
           void initModel(const char *filename);
-          void Draw(/**float, float, float, float, float, float, float**/);
+          void Update(float deltaTime);                                           //advance the model's own instance
+          void Draw(/**float, float, float, float, float, float, float**/);      //the model's own instance
+          void DrawFrame(int n, float interp);                                    //any frame pair, for _md2Instance
           void FreeModel (struct md2_model_t *mdl);
 
           void Actions();
 
 
           enum {STAND, WALKLEFT,WALKRIGHT,RUN,JUMP, PAIN, ATTACK};                        //model actions
+          static const int ActionFrames[ATTACK + 1][2];                             //first and last frame by action, -1 where the model has none
           int actionTrigger =0;                                                     //action trigger
           int StartFrame =0;
           int EndFrame;
 
           vec3 pos;
 
+          /* Indexed mesh built from the glcmds: one entry per unique (index, s, t) */
+          std::vector<struct md2_glcmd_t> meshVerts;
+          std::vector<unsigned short> meshIndices;                                 //triangle list into meshVerts
+          float *frameBuffer = nullptr;                                            //x,y,z,1, nx,ny,nz,0 per mesh vertex, 16-byte aligned
+
+          GLuint vboFrame = 0;                                                      //dynamic: interpolated positions and normals
+          GLuint vboFrames = 0;                                                     //static, every frame for _gpuMD2; 0 without GLSL
+          GLuint vboTexCoords = 0;                                                  //static
+          GLuint iboMesh = 0;                                                       //static
+
     protected:
 
     private:
+          _md2Instance *ownInstance = nullptr;                                      //created by the first Update
 };
 
 #endif // _3DMODELLOADER_H
@@ -17,6 +17,15 @@
 #include <_sounds.h>
 #include <_gltfLoader.h>
 #include <_sceneSwitcher.h>
+#include <_assetLoader.h>
+#include <_animationSystem.h>
+#include <_gpuSkinning.h>
+#include <_gpuMD2.h>
+#include <_gpuInstancing.h>
+#include <_staticBatch.h>
+#include <_frustumCuller.h>
+#include <_occlusionCuller.h>
+#include <_pvs.h>
 
 class _Scene
 {
@@ -31,6 +40,9 @@ public:
     int winMsg(HWND, UINT, WPARAM, LPARAM);
     void mouseMapping(int, int);
 
+    void addLevelGeometry(_staticBatch *);                  //ground, pedestals and platform in world space
+    void bakePVS();                                         //offline: writes models/level.pvs for the current layout
+
     double msX, msY, msZ;
     int width, height;
     int clickCount;
@@ -63,6 +75,13 @@ public:
     _camera *myCam;
     _collisionCheck *myCol;
     _sounds *snds;
+    _assetLoader *assets;
+    _textureStreamer *streamer;
+    _animationSystem *animations;
+    _staticBatch *levelBatch;
+    _frustumCuller *culler;
+    _occlusionCuller *occlusion;
+    _pvs *pvs;                                              //null when no bake matches the level
     _sceneSwitcher *sceneSwitcher = new _sceneSwitcher();
 
     _bullets b[10];
@@ -75,6 +94,13 @@ public:
     GltfModel* pedestalBase;
     GltfModel* pedestal;
     GltfModel* platform1;
+    glm::mat4 platformWorld;                                //platform1 placement, shared by drawing and culling
+    bool animDemo = false;                                  //-animdemo: a row of animated cubes and animation stats
+    GltfModel* animCube;                                    //shared by every entry of animCubes, loaded only for animDemo
+    std::vector<_animInstance*> animCubes;                  //a row running away from the start, posed by animations
+
+    std::vector<glm::mat4> skullMatrices;                  //per-frame instance data for myGltfModel2
+    std::vector<glm::vec4> skullColors;
 
     // ---- load model texture ----
     _textureLoader *testTexture = new _textureLoader();
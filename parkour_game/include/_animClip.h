@@ -0,0 +1,107 @@
+#ifndef _ANIMCLIP_H
+#define _ANIMCLIP_H
+
+#include <_common.h>
+#include <cgltf.h>
+#include <xmmintrin.h>
+#include <string>
+#include <vector>
+
+/* Local transform of one node, each part padded to 4 floats for SSE */
+struct nodeTRS_t
+{
+  float translation[4];         // x,y,z,(unused)
+  float rotation[4];            // x,y,z,w
+  float scale[4];               // x,y,z,(unused)
+};
+
+// Engine-owned copy of one glTF animation, decoded once at load.
+// Key times and values live in two flat 16-byte aligned arrays, with the
+// tracks sorted by target node and path so a sample pass walks memory in
+// order instead of chasing cgltf accessors.
+// Morph weight channels are kept as separate tracks that write into a flat
+// weight array, one slot per morph target (see GltfModel::morphSlot).
+// compress() can then drop redundant keys and pack the rest into 48 bits:
+// smallest-three rotations, translations and scales quantised to each
+// track's range. sample() decodes packed keys on the fly.
+class _animClip
+{
+    public:
+        _animClip();
+        virtual ~_animClip();
+
+        enum {TRANSLATION, ROTATION, SCALE};
+        enum {STEP, LINEAR, CUBICSPLINE};
+
+        bool build(const cgltf_data *, const cgltf_animation *, const std::vector<int> &);    //decode every channel; first morph weight slot by node (-1 = none)
+        void sample(float, nodeTRS_t *, int *, unsigned char *) const;  //time, pose by node, cursor per track, dirty flag by node or null
+        bool sampleWeights(float, float *, int *) const;   //time, morph weights by slot, cursors; true if any weight changed
+
+        bool compress(float);                               //max error per component; once, before any instance samples the clip
+        size_t byteSize() const;                            //decoded key data plus track headers
+        int keyCount() const;                               //keys over all transform tracks
+
+        int trackCount() const { return (int)(tracks.size() + weightTracks.size()); }   //cursors needed, weight tracks last
+        bool hasWeights() const { return !weightTracks.empty(); }
+        const std::vector<int> &targetNodes() const { return nodes; }  //every node the clip writes, ascending
+
+        static void blendPose(const nodeTRS_t *, const nodeTRS_t *, float, const std::vector<int> &, nodeTRS_t *, unsigned char *);  //from, to, weight, nodes, out, dirty or null
+
+        std::string name;
+        float duration = 0.0f;                              //last key time over all tracks
+        float maxError = 0.0f;                              //from compress(), at every original key and midpoint
+        bool compressed = false;
+
+    protected:
+
+    private:
+        _animClip(const _animClip &);                       //owns raw aligned buffers, not copyable
+        _animClip &operator=(const _animClip &);
+
+        struct animTrack
+        {
+            int node;                                       //index into cgltf_data::nodes
+            int path;                                       //TRANSLATION, ROTATION, SCALE
+            int interp;                                     //STEP, LINEAR, CUBICSPLINE
+            int keyCount;
+            int timeOffset;                                 //first key time in keyTimes
+            int valueOffset;                                //first key value in keyValues, or first key in packedKeys
+            bool packed;                                    //values are 3 shorts per key in packedKeys
+            float rangeMin[4];                              //packed translation/scale: value = min + q * scale
+            float rangeScale[4];
+        };
+
+        struct weightTrack
+        {
+            int slot;                                       //first morph weight written
+            int count;                                      //morph targets on the node's mesh
+            int stride;                                     //count rounded up to 4 floats
+            int interp;
+            int keyCount;
+            int timeOffset;
+            int valueOffset;                                //first float in weightValues
+        };
+
+        static int findKey(const float *, int, float, int &);
+
+        static __m128 unpackKey(const animTrack &, const unsigned short *);   //track, its packed key
+        static void packRotation(const float *, unsigned short *);
+        static __m128 unpackRotation(const unsigned short *);
+
+        std::vector<animTrack> tracks;
+        std::vector<int> nodes;
+
+        float *keyTimes = nullptr;                          //shared between tracks with the same input accessor
+        __m128 *keyValues = nullptr;                        //one vec4 per key, three per key for CUBICSPLINE
+        int timeCount = 0;
+        int valueCount = 0;
+
+        unsigned short *packedKeys = nullptr;               //48 bits per key, after compress()
+        int packedCount = 0;
+
+        std::vector<weightTrack> weightTracks;
+        float *weightValues = nullptr;                      //stride floats per key, three per key for CUBICSPLINE
+        int weightValueCount = 0;
+};
+
+#endif // _ANIMCLIP_H
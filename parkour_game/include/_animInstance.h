@@ -0,0 +1,84 @@
+#ifndef _ANIMINSTANCE_H
+#define _ANIMINSTANCE_H
+
+#include <_common.h>
+#include <gltfModel.h>
+#include <vector>
+
+// Playback state and pose for one copy of an animated GltfModel.
+// The model (meshes, clips, rest pose, hierarchy) is shared and never
+// written; each instance only owns buffers sized by the node count.
+class _animInstance
+{
+    public:
+        _animInstance(GltfModel *);
+        virtual ~_animInstance();
+
+        void play(int, bool);                               //clip index, loop
+        void setTime(float);                                //seek, seconds
+        void update(float);                                 //advance by delta seconds, sample, propagate
+        bool updateLOD(float, int);                         //delta seconds, sample every Nth frame and blend between; true if it sampled
+        void skip(float);                                   //culled: clip time moves on, pose is left stale
+        void draw();                                        //model geometry under this instance's root transform
+
+        // CPU skinning: palette once per frame, then vertex ranges from any thread
+        void buildJointMatrices();
+        void allocateSkinBuffer();                          //CPU path only; the GPU path never needs it
+        void skinRange(int, int);                           //first vertex, count
+        int vertexCount() const { return (int)model->vertices.size() / 3; }
+
+        // morph targets: weights come from the clip, deltas are blended in vertex ranges before skinning
+        bool prepareMorph();                                //true if the weights moved since the last blend
+        void morphRange(int, int);                          //first vertex, count
+
+        size_t poseBytes() const;                           //memory owned by this instance
+
+        GltfModel *model;
+
+        int clip = 0;
+        float time = 0.0f;
+        float speed = 1.0f;
+        bool loop = true;
+
+        vec3 position = {0, 0, 0};                          //world position, for LOD distance
+        bool visible = true;                                //false while culled
+        int lodSlot = 0;                                    //staggers reduced-rate sampling across a crowd
+
+        std::vector<nodeTRS_t> pose;                        //local TRS, by node
+        std::vector<glm::mat4> nodeLocalTransforms;
+        std::vector<glm::mat4> nodeGlobalTransforms;
+
+        std::vector<glm::mat4> jointMatrices;               //global * inverse bind, per skin joint
+        float *skinnedVertices = nullptr;                   //x,y,z,1, nx,ny,nz,0 per vertex, 16-byte aligned
+
+        std::vector<float> morphWeights;                    //by slot, starts at the model's defaults
+        float *morphedVertices = nullptr;                   //bind pose plus weighted deltas, same layout; feeds skinning when skinned
+
+        GLuint skinVBO = 0;                                 //streamed copy of skinnedVertices, or of morphedVertices for rigid models
+        bool skinChanged = false;                           //streamed vertices newer than skinVBO
+
+    protected:
+
+    private:
+        _animInstance(const _animInstance &);               //owns an aligned buffer and a VBO, not copyable
+        _animInstance &operator=(const _animInstance &);
+
+        void computeGlobalTransforms();                     //one pass over the model's flat hierarchy
+        const _animClip *currentClip() const;
+        float wrapTime(float) const;
+
+        std::vector<int> cursors;                           //keyframe cursor per track of the current clip
+        std::vector<unsigned char> nodeDirty;               //local TRS changed since last update, by node
+        std::vector<unsigned char> nodeMoved;               //global changed during this update, by node
+        std::vector<float> blendedWeights;                  //weights morphedVertices was built with
+
+        // reduced-rate updates: sample a target pose ahead, blend towards it over lodRate frames
+        std::vector<nodeTRS_t> poseFrom;
+        std::vector<nodeTRS_t> poseTo;
+        int lodRate = 1;                                    //rate asked for last frame
+        int lodFrames = 1;                                  //length of the current blend cycle
+        int lodPhase = 0;
+        bool stale = false;                                 //pose is out of date after being culled
+};
+
+#endif // _ANIMINSTANCE_H
@@ -0,0 +1,81 @@
+#ifndef _ANIMATIONSYSTEM_H
+#define _ANIMATIONSYSTEM_H
+
+#include <_common.h>
+#include <_threadPool.h>
+#include <_animInstance.h>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+// Updates every registered _animInstance once per frame. Instances are
+// split into contiguous chunks that the workers and the calling thread
+// pull from a shared counter; update() returns only when all chunks are
+// done, so the poses are safe to render afterwards.
+// Instances far from the viewer are sampled every 2nd or 4th frame and
+// blended in between; culled instances only advance their clip time.
+// Visible skinned instances then get their joint palette, and are skinned
+// on the CPU in vertex ranges unless _gpuSkinning can draw them. Morph
+// targets are blended in the same vertex ranges, just before skinning,
+// and only when an instance's weights moved.
+class _animationSystem
+{
+    public:
+        _animationSystem(int numThreads = 0);               //total threads including the caller, 0 = one per core
+        virtual ~_animationSystem();
+
+        void add(_animInstance *);
+        void remove(_animInstance *);
+
+        void update(float);                                 //delta seconds; barrier before returning
+
+        static void benchmark(GltfModel *, int, int);       //model, instance count, frames: prints 1..N thread speedup
+
+        void printStats();                                  //last frame's sampled / blended / culled counts
+        void report();                                      //every reportInterval seconds: updates skipped per frame since the last report
+
+        std::vector<_animInstance *> instances;
+        int chunkSize = 32;                                 //instances per job
+
+        vec3 viewer = {0, 0, 0};                            //camera position for LOD distances
+        float lodDistance[2] = {25.0f, 50.0f};              //beyond [0] update every 2nd frame, beyond [1] every 4th
+
+        int sampledCount = 0;                               //last frame: full clip samples
+        int blendedCount = 0;                               //last frame: in-between frames, no sampling
+        int culledCount = 0;                                //last frame: not visible, time only
+
+        int skinChunk = 4096;                               //vertices per skinning / morph job
+        int skinnedVerts = 0;                               //last frame
+        int morphedVerts = 0;                               //last frame
+        double skinMs = 0.0;                                //last frame, wall time of the morph + skinning phase
+
+        float reportInterval = 2.0f;                        //seconds of update() time between report() lines
+
+    protected:
+
+    private:
+        void runParallel(int, const std::function<void(int)> &);   //job count, job; caller helps, returns when all are done
+        void poseChunk(int, float);                         //chunk index, delta seconds
+        void deformAll();                                   //morph and skin visible instances
+
+        struct skinJob
+        {
+            _animInstance *inst;
+            int first;
+            int count;
+            bool morph;                                     //blend morph targets first
+            bool skin;
+        };
+        std::vector<skinJob> skinJobs;                      //rebuilt every frame, capacity kept
+
+        _threadPool *pool = nullptr;                        //null when running on the calling thread only
+        std::atomic<int> nextChunk;
+        std::atomic<int> sampled, blended, culled;
+
+        // summed over the frames since the last report()
+        float reportTime = 0.0f;
+        int reportFrames = 0;
+        long long reportSampled = 0, reportBlended = 0, reportCulled = 0;
+};
+
+#endif // _ANIMATIONSYSTEM_H
@@ -0,0 +1,81 @@
+#ifndef _ASSETLOADER_H
+#define _ASSETLOADER_H
+
+#include <_common.h>
+#include <_threadPool.h>
+#include <_textureLoader.h>
+#include <_3DModelLoader.h>
+#include <_gltfLoader.h>
+#include <gltfModel.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+
+// Loads assets in two phases: file I/O, parsing and decoding run on the
+// worker pool, then update() finishes the GL upload on the context thread.
+// Every load returns a handle; the out pointer is written once it is ready.
+class _assetLoader
+{
+    public:
+        _assetLoader(int numThreads = 0);
+        virtual ~_assetLoader();
+
+        int loadTexture(_textureLoader *, const char *, GLuint *);         //loader, filename, out texture id
+        int loadModel(_gltfLoader *, const std::string &, GltfModel **);   //loader, filename, out model
+        int loadMD2(_3DModelLoader *, const char *);                        //model, filename
+
+        bool isReady(int);                  //true once the handle has been uploaded
+        void update();                      //GL thread: upload whatever finished decoding
+        void finishAll();                   //GL thread: block until every handle is ready
+
+        void printTimeline();               //per asset decode/upload spans
+
+        _threadPool *pool;
+        _textureStreamer *streamer = nullptr;   //when set, textures upload through PBOs over several frames
+
+    protected:
+
+    private:
+        enum {TEXTURE, MODEL, MD2};
+
+        struct assetJob
+        {
+            int type;
+            std::string fileName;
+
+            _textureLoader *tex = nullptr;
+            _gltfLoader *gltf = nullptr;
+            _3DModelLoader *md2 = nullptr;
+            GLuint *outID = nullptr;
+            GLuint texID = 0;
+            std::string path;                   //canonical texture path
+            unsigned long long hash = 0;        //texture file content hash
+            std::vector<unsigned char> baked;   //.dds bytes when a baked version exists
+            GltfModel **outModel = nullptr;
+
+            // worker results
+            unsigned char *pixels = nullptr;
+            int width = 0, height = 0;
+            GltfModel *model = nullptr;
+            bool ok = false;
+
+            // timeline, ms since the loader was created
+            double decodeStart = 0, decodeEnd = 0;
+            double uploadStart = 0, uploadEnd = 0;
+            int worker = -1;
+
+            std::atomic<bool> decoded{false};
+            bool uploaded = false;
+        };
+
+        int addJob(assetJob *);
+        void decode(assetJob *);
+        void upload(assetJob *);
+        double now();
+
+        std::vector<assetJob *> jobs;
+        std::chrono::steady_clock::time_point startTime;
+};
+
+#endif // _ASSETLOADER_H
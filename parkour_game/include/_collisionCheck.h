@@ -31,7 +31,7 @@ public:
     // ---- Ray / triangle ----
     bool rayIntersectTriangle(const vec3& orig, const vec3& dir,
                               const vec3& v0, const vec3& v1, const vec3& v2,
-                              float& outT, float& outU, float& outV);
+                              float& outT, float& outU, float& outV) const;
 
     bool raycastMeshNearest(const vec3& orig, const vec3& dir,
                         const std::vector<Triangle>& triangles,
@@ -41,8 +41,26 @@ public:
                                    const vec3& planePoint,
                                    const vec3& planeNormal);
 
+    // ---- BVH over a static triangle set, for many ray queries ----
+    // read-only once built, so any number of threads can query it at once
+    void buildBVH(const std::vector<Triangle>& triangles);
+    bool segmentBlocked(const vec3& from, const vec3& to) const;   // any triangle strictly between the two points
+    int segmentCrossings(const vec3& from, const vec3& to) const;  // every triangle between them; odd from a point inside a closed mesh
+    int bvhNodeCount() const { return (int)bvhNodes.size(); }
+
 private:
     float sqr(float x) { return x*x; }
+
+    struct bvhNode {
+        float mn[3], mx[3];
+        int first;                  // leaf: first triangle, inner: left child (right is first + 1)
+        int count;                  // triangles in a leaf, 0 for inner nodes
+    };
+    void splitBVH(int node, int depth);
+    int segmentHits(const vec3& from, const vec3& to, bool firstOnly) const;
+
+    std::vector<bvhNode> bvhNodes;
+    std::vector<Triangle> bvhTris;  // reordered so every leaf is a contiguous range
 };
 
 #endif
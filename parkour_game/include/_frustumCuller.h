@@ -0,0 +1,55 @@
+#ifndef _FRUSTUMCULLER_H
+#define _FRUSTUMCULLER_H
+
+#include <_common.h>
+#include <gltfModel.h>
+#include <vector>
+
+// View frustum culling for world instances. Each frame: extract() the six
+// planes, add() every instance with its model bounds and world matrix,
+// cull() once, then ask visible() before drawing. Bounds are kept as
+// structure-of-arrays so the plane tests run four instances per SSE op;
+// an instance is dropped when its box or its sphere is outside any plane.
+class _frustumCuller
+{
+    public:
+        _frustumCuller();
+        virtual ~_frustumCuller();
+
+        void extract();                                     //from the current GL projection and modelview (camera only)
+        void extract(const glm::mat4 &);                    //projection * view
+
+        int add(const GltfModel::Bounds &, const glm::mat4 &);     //model-space bounds, world matrix; returns a handle
+        int add(const GltfModel *, const glm::mat4 &);      //whole model under its root transform
+        void cull();                                        //tests everything added since extract()
+        bool visible(int handle) const { return handle >= 0 && handle < count && visibleFlags[handle]; }
+
+        // for later passes over the survivors (occlusion)
+        const glm::mat4 &viewProjection() const { return viewProj; }
+        int instanceCount() const { return count; }
+        glm::vec3 worldCenter(int i) const { return glm::vec3(cx[i], cy[i], cz[i]); }
+        glm::vec3 worldExtent(int i) const { return glm::vec3(ex[i], ey[i], ez[i]); }
+        void hide(int i) { visibleFlags[i] = 0; }           //the counts below stay the frustum's own
+
+        void report();                                      //prints the counts when they change from the last report
+
+        int submitted = 0;                                  //last cull()
+        int culled = 0;
+
+    protected:
+
+    private:
+        glm::mat4 viewProj;
+        float planes[6][4];                                 //a,b,c,d with unit normals, inside when >= 0
+
+        int count = 0;
+        std::vector<float> cx, cy, cz;                      //world centre, shared by box and sphere
+        std::vector<float> ex, ey, ez;                      //world box half extents
+        std::vector<float> radius;                          //world sphere radius
+        std::vector<unsigned char> visibleFlags;
+
+        int reportedSubmitted = -1;
+        int reportedCulled = -1;
+};
+
+#endif // _FRUSTUMCULLER_H
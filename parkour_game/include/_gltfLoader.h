@@ -5,6 +5,7 @@
 #include "cgltf.h"
 #include <iostream>
 #include <SOIL2.h>
+#include <_textureCache.h>
 
 class GltfModel;
 
@@ -13,6 +14,9 @@ public:
     _gltfLoader();
     ~_gltfLoader();
 
-    GltfModel* loadModel(const std::string& filename);
+    GltfModel* loadModel(const std::string& filename);      // parseModel() + uploadModel()
+
+    GltfModel* parseModel(const std::string& filename);     // file I/O, parsing, image decode (no GL calls)
+    void uploadModel(GltfModel* model);                     // GL thread: textures and buffers
     cgltf_data* data = nullptr;
 };
@@ -0,0 +1,47 @@
+#ifndef _GPUINSTANCING_H
+#define _GPUINSTANCING_H
+
+#include <_common.h>
+#include <_shader.h>
+#include <gltfModel.h>
+#include <vector>
+
+// Hardware instancing for rigid GltfModels. Per-instance model matrices
+// and colours are streamed into one instance buffer (divisor 1) and every
+// copy goes out in a single glDrawElementsInstanced, reusing the model's
+// static VBOs. Called through GltfModel::drawInstanced, which falls back
+// to one draw per copy when this is unavailable.
+class _gpuInstancing
+{
+    public:
+        static _gpuInstancing* instance();
+
+        bool init();                                        //GL thread, once; false without GLSL or instanced arrays
+        bool canDraw(const GltfModel *);                    //initialised, uploaded, not skinned or morphed
+
+        void draw(GltfModel *, const std::vector<glm::mat4> &, const std::vector<glm::vec4> &);   //model, world matrices, colours
+
+        int drawCalls = 0;                                  //since the last resetStats()
+        int instancesDrawn = 0;
+        void resetStats() { drawCalls = instancesDrawn = 0; }
+
+    protected:
+
+    private:
+        _gpuInstancing();
+        virtual ~_gpuInstancing();
+
+        _shader shader;
+        GLuint instanceVBO = 0;
+        size_t instanceCapacity = 0;                        //instances the buffer was last sized for
+
+        std::vector<float> staging;                         //16 matrix + 4 colour floats per instance
+
+        GLint matrixAttrib = -1;                            //4 consecutive locations, one per column
+        GLint colorAttrib = -1;
+        GLint useTexture = -1;
+
+        bool ready = false;
+};
+
+#endif // _GPUINSTANCING_H
@@ -0,0 +1,43 @@
+#ifndef _GPUMD2_H
+#define _GPUMD2_H
+
+#include <_common.h>
+#include <_shader.h>
+#include <_3DModelLoader.h>
+
+// Vertex-shader MD2 interpolation. Every frame stays on the GPU in the
+// loader's vboFrames (u8 positions, byte normals); a draw only points two
+// attribute pairs at the current and next frame and sets their scale,
+// translate and the interp factor, so the CPU does no per-vertex work.
+class _gpuMD2
+{
+    public:
+        static _gpuMD2* instance();
+
+        bool init();                                        //GL thread, once; false without GLSL
+        bool canDraw(const _3DModelLoader *);               //initialised and the model's frames are uploaded
+
+        void draw(_3DModelLoader *, int, float);            //model, frame, interp towards the next frame
+
+    protected:
+
+    private:
+        _gpuMD2();
+        virtual ~_gpuMD2();
+
+        _shader shader;
+
+        GLint positionA = -1;                               //bound to location 0
+        GLint positionB = -1;
+        GLint normalA = -1;
+        GLint normalB = -1;
+
+        GLint scaleA = -1, translateA = -1;
+        GLint scaleB = -1, translateB = -1;
+        GLint interp = -1;
+        GLint useTexture = -1;
+
+        bool ready = false;
+};
+
+#endif // _GPUMD2_H
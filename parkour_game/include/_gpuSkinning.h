@@ -0,0 +1,41 @@
+#ifndef _GPUSKINNING_H
+#define _GPUSKINNING_H
+
+#include <_common.h>
+#include <_shader.h>
+#include <gltfModel.h>
+#include <vector>
+
+// Vertex-shader skinning for hardware GL contexts. The bind pose, joints
+// and weights stay in the static VBOs from GltfModel::uploadToGPU; the only
+// per-draw upload is the joint palette, streamed into a uniform buffer.
+// Models it cannot take fall back to the CPU path in _animationSystem.
+class _gpuSkinning
+{
+    public:
+        static _gpuSkinning* instance();
+
+        enum {MAX_JOINTS = 128};                            //128 mat4 = 8 KB, half the minimum UBO size
+
+        bool init();                                        //GL thread, once; false if shaders or UBOs are missing
+        bool canSkin(const GltfModel *);                    //initialised, within MAX_JOINTS, no morph targets
+
+        void draw(GltfModel *, const std::vector<glm::mat4> &);   //model, joint palette
+
+    protected:
+
+    private:
+        _gpuSkinning();
+        virtual ~_gpuSkinning();
+
+        _shader shader;
+        GLuint paletteUBO = 0;
+
+        GLint jointAttrib = -1;
+        GLint weightAttrib = -1;
+        GLint useTexture = -1;
+
+        bool ready = false;
+};
+
+#endif // _GPUSKINNING_H
@@ -17,6 +17,7 @@
 #include <_sounds.h>
 #include <_gltfLoader.h>
 #include <_sceneSwitcher.h>
+#include <_assetLoader.h>
 
 class _mainMenu
 {
@@ -73,6 +74,8 @@ public:
     _inputs *myInput;
     _camera *myCam;
     _sounds *snds;
+    _assetLoader *assets;
+    _textureStreamer *streamer;
 
 
     //load UI textures;
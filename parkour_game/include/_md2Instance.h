@@ -0,0 +1,34 @@
+#ifndef _MD2INSTANCE_H
+#define _MD2INSTANCE_H
+
+#include <_common.h>
+#include <_3DModelLoader.h>
+
+// Animation state for one character drawn from a shared _3DModelLoader.
+// The loaded frames and buffers are never written, so one model can drive
+// any number of instances playing different actions at their own pace.
+class _md2Instance
+{
+    public:
+        _md2Instance(_3DModelLoader *);
+        virtual ~_md2Instance();
+
+        void setAction(int);                                //_3DModelLoader::STAND, RUN, ...
+        void setFrames(int, int);                           //first and last frame of the loop
+        void update(float);                                 //advance by delta seconds
+        void draw();                                        //current frame, interpolated towards the next
+
+        _3DModelLoader *model;
+
+        int frame = 0;
+        float interp = 0.0f;                                //0..1 towards frame + 1
+        int startFrame = 0;
+        int endFrame = 0;
+        float framesPerSecond = 10.0f;
+
+    protected:
+
+    private:
+};
+
+#endif // _MD2INSTANCE_H
@@ -0,0 +1,57 @@
+#ifndef _OCCLUSIONCULLER_H
+#define _OCCLUSIONCULLER_H
+
+#include <_common.h>
+#include <_threadPool.h>
+#include <_frustumCuller.h>
+#include <gltfModel.h>
+#include <vector>
+
+// Software occlusion culling. A few large occluder meshes are rasterized
+// (SSE2, four pixels per step) into a small depth buffer on a worker
+// thread while the frame is being set up; a Hi-Z pyramid of the farthest
+// depth per texel is built on top. Instances that survived the frustum are
+// then hidden when the nearest point of their box lies behind every
+// occluder texel it covers. Occluders are sampled at pixel centres and
+// clipped against the near plane, so a floor or wall running past the
+// camera still occludes what is behind it.
+class _occlusionCuller
+{
+    public:
+        _occlusionCuller(int = 256, int = 128);             //depth buffer width (multiple of 4), height
+        virtual ~_occlusionCuller();
+
+        void addOccluder(GltfModel *, const glm::mat4 &);   //model, world transform; baked once at load
+
+        void render(const glm::mat4 &);                     //projection * view; starts rasterizing on the worker
+        void cull(_frustumCuller *);                        //waits for render(), hides occluded instances
+
+        void report();                                      //prints the counts when they change from the last report
+
+        int tested = 0;                                     //last cull()
+        int occluded = 0;
+        double rasterMs = 0.0;                              //worker time for the depth buffer and pyramid
+        double testMs = 0.0;                                //main thread time in cull(), wait included
+
+    protected:
+
+    private:
+        void rasterize();                                   //worker: all occluders, then the pyramid
+        void drawTriangle(const glm::vec4 &, const glm::vec4 &, const glm::vec4 &);   //screen x,y, depth 0..1, unused w
+        bool isOccluded(const glm::vec3 &, const glm::vec3 &) const;                 //world box centre, half extents
+
+        int width, height;
+        std::vector<float> occluderVerts;                   //world x,y,z per vertex, three per triangle
+
+        std::vector<std::vector<float>> levels;             //levels[0] is the depth buffer, each next one 2x2 max
+        std::vector<int> levelWidth, levelHeight;
+
+        glm::mat4 viewProj;
+        _threadPool *worker;
+        bool pending = false;
+
+        int reportedTested = -1;
+        int reportedOccluded = -1;
+};
+
+#endif // _OCCLUSIONCULLER_H
@@ -0,0 +1,60 @@
+#ifndef _PVS_H
+#define _PVS_H
+
+#include <_common.h>
+#include <_staticBatch.h>
+#include <_collisionCheck.h>
+#include <vector>
+
+// Potentially visible sets for a static level. Offline, bake() splits the
+// level into a grid of cells and decides, for every cell and every object
+// of the level's _staticBatch, whether any ray from the cell reaches the
+// object's surface (rays go through _collisionCheck's BVH, cells are spread
+// over a thread pool, and ray starts buried inside solid geometry are
+// dropped). Objects touching a cell or its neighbours always
+// count, and each set is widened by its six neighbours to cover what the
+// sampling missed. Sets are stored deduplicated and run-length encoded.
+// At runtime the camera's cell gives a bitset for _staticBatch::submit().
+class _pvs
+{
+    public:
+        _pvs();
+        virtual ~_pvs();
+
+        // ---- Offline ----
+        void bake(const _staticBatch *, float, int, int = 0);     //unbuilt batch, cell size, rays per cell/object pair, threads (0 = all cores)
+        bool save(const char *);
+
+        // ---- Runtime ----
+        bool load(const char *, const _staticBatch *);      //false (and says why) when missing, damaged or baked for another layout
+        const unsigned char *visibleSet(const glm::vec3 &) const;   //bit per object, null outside the grid
+
+        void printStats(const char *);                      //level name
+
+        double bakeMs = 0.0;
+        long long raysCast = 0;
+
+    protected:
+
+    private:
+        static unsigned int layoutHash(const _staticBatch *);       //changes whenever an object moves or is added
+        static void encode(const std::vector<unsigned char> &, std::vector<unsigned char> &);
+        static bool decode(const unsigned char *, size_t, size_t, std::vector<unsigned char> &);   //rle, rle size, set size, output
+
+        void storeSets(const std::vector<unsigned char> &);         //one set per cell, back to back
+        void cellRuns(std::vector<unsigned int> &) const;           //cell table run-length encoded
+
+        glm::vec3 origin = glm::vec3(0.0f);
+        float cellSize = 1.0f;
+        int dims[3] = {0, 0, 0};
+        int objectCount = 0;
+        unsigned int hash = 0;
+
+        std::vector<unsigned int> cellSet;                  //index into sets for every cell; a 256^3 grid can pass 65535 sets
+        std::vector<std::vector<unsigned char>> sets;       //unique bitsets, decoded
+        size_t storedBytes = 0;                             //encoded size of sets + cell table
+
+        std::vector<int> objectTriangles;                   //per object, for the draw reduction in the report
+};
+
+#endif // _PVS_H
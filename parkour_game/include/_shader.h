@@ -0,0 +1,32 @@
+#ifndef _SHADER_H
+#define _SHADER_H
+
+#include <_common.h>
+
+// Small GLSL program wrapper: compile, link, look up uniforms/attributes.
+// Compile and link errors are printed with the shader log.
+class _shader
+{
+    public:
+        _shader();
+        virtual ~_shader();
+
+        static bool supported();                            //GLSL 1.20 available on this context
+        static const char *litFragmentSource;               //light0 + colour + optional texture, like the fixed pipeline
+
+        bool loadFromSource(const char *, const char *, const char * = NULL);   //vertex source, fragment source, attribute for location 0
+        void bind();
+        void unbind();
+
+        GLint uniform(const char *);
+        GLint attribute(const char *);
+
+        GLuint program = 0;
+
+    protected:
+
+    private:
+        GLuint compile(GLenum, const char *);
+};
+
+#endif // _SHADER_H
@@ -0,0 +1,67 @@
+#ifndef _STATICBATCH_H
+#define _STATICBATCH_H
+
+#include <_common.h>
+#include <gltfModel.h>
+#include <_frustumCuller.h>
+#include <vector>
+
+// Static level geometry merged per material. Models that never move are
+// added once with their world transform; build() bakes the transform into
+// one interleaved vertex buffer and one index buffer per texture, so the
+// level costs one draw call per material however many objects it has.
+// Each added model stays an object with its own index range and bounds,
+// so culling works per object and a batch draws only its visible ranges.
+class _staticBatch
+{
+    public:
+        _staticBatch();
+        virtual ~_staticBatch();
+
+        int add(GltfModel *, const glm::mat4 &);            //model, world transform; uses the model's textureID; returns the object, -1 if empty
+        void build();                                       //GL thread, after every add()
+
+        void submit(_frustumCuller *, const unsigned char * = nullptr);   //every object's bounds; bit i of the optional set clear skips object i
+        void draw(const _frustumCuller * = nullptr);        //caller sets colour and the view transform; skips culled objects
+
+        const GltfModel::Bounds &objectBounds(int i) const { return objects[i].bounds; }
+        int objectTriangles(int i) const { return objects[i].indexCount / 3; }
+        void worldTriangles(int, std::vector<Triangle> &) const;   //object, output; before build() only
+
+        void printStats();
+
+        int objectCount = 0;
+        int triangleCount = 0;
+        int drawnObjects = 0;                               //last draw()
+
+    protected:
+
+    private:
+        struct batch
+        {
+            GLuint textureID;
+            std::vector<float> vertices;                    //x,y,z, nx,ny,nz, u,v per vertex
+            std::vector<unsigned int> indices;
+            GLuint vbo;
+            GLuint ebo;
+        };
+
+        struct object
+        {
+            int batch;
+            GLsizei firstIndex;
+            GLsizei indexCount;
+            GltfModel::Bounds bounds;                       //world space
+            int cullHandle;                                 //from the last submit(), -1 when skipped
+        };
+
+        int batchFor(GLuint);                               //texture id, creates the batch on first use
+
+        std::vector<batch> batches;
+        std::vector<object> objects;                        //in add() order, each batch's ranges ascending
+
+        std::vector<GLsizei> drawCounts;                    //draw() scratch for glMultiDrawElements
+        std::vector<const GLvoid *> drawOffsets;
+};
+
+#endif // _STATICBATCH_H
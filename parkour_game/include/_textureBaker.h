@@ -0,0 +1,69 @@
+#ifndef _TEXTUREBAKER_H
+#define _TEXTUREBAKER_H
+
+#include <_common.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* DDS container, only the subset the baker writes */
+struct dds_pixelformat_t
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t rMask, gMask, bMask, aMask;
+};
+
+struct dds_header_t
+{
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  struct dds_pixelformat_t ddspf;
+  uint32_t caps, caps2, caps3, caps4;
+  uint32_t reserved2;
+};
+
+#define DDS_MAGIC       0x20534444          // "DDS "
+#define DDS_FOURCC_DXT1 0x31545844          // "DXT1"
+#define DDS_FOURCC_DXT5 0x35545844          // "DXT5"
+#define DDS_MAX_SIZE    16384               // largest side accepted from a file
+
+// Offline tool: turns source images into .dds files next to them, with a
+// full box-filtered mip chain and optional BC1/BC3 (S3TC) compression.
+// _textureLoader picks the .dds up instead of decoding the source.
+class _textureBaker
+{
+    public:
+        _textureBaker();
+        virtual ~_textureBaker();
+
+        enum {RGBA8, BC1, BC3, AUTO};                       //AUTO = BC3 if the image has alpha, else BC1
+
+        bool bakeFile(const char *, const char *, int);     //source image, output .dds, format
+        int bakeDirectory(const char *, int);               //bakes every .jpg/.png in a folder, returns count
+
+        static std::string bakedPath(const char *);         //images/foo.png -> images/foo.png.dds
+        static bool bakeIsCurrent(const char *);            //source image; its bake exists and is no older than it
+        static void buildMip(const unsigned char *, int, int, std::vector<unsigned char> &, int &, int &);  //2x2 box filter
+
+        long long sourceBytes = 0;                          //RGBA8 size of level 0, summed over baked files
+        long long bakedBytes = 0;                           //size of all levels written
+
+    protected:
+
+    private:
+        void compressLevel(const unsigned char *, int, int, bool, std::vector<unsigned char> &);
+
+        void encodeColorBlock(const unsigned char *, unsigned char *);
+        void encodeAlphaBlock(const unsigned char *, unsigned char *);
+};
+
+#endif // _TEXTUREBAKER_H
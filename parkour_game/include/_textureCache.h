@@ -0,0 +1,58 @@
+#ifndef _TEXTURECACHE_H
+#define _TEXTURECACHE_H
+
+#include <_common.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// Global texture cache keyed by canonical path and by a hash of the file
+// contents, so the same image is decoded and uploaded once no matter who
+// asks for it or under which name. Handles are refcounted; the GL texture
+// is deleted when the last owner releases it.
+class _textureCache
+{
+    public:
+        static _textureCache *instance();
+
+        static std::string canonicalPath(const char *);                     //lower case, '/' separators, no . or ..
+        static unsigned long long hashBytes(const unsigned char *, size_t); //64-bit FNV-1a
+        static bool readFile(const char *, std::vector<unsigned char> &);
+
+        bool contains(const std::string &, unsigned long long);             //path, hash (0 = path only); thread safe
+        GLuint acquire(const std::string &, unsigned long long, int *, int *); //GL thread, 0 on miss, counts a hit
+        void insert(const std::string &, unsigned long long, GLuint, int, int, long long);   //GL thread, counts a miss; last is GPU bytes
+        void release(GLuint);                                               //GL thread, deletes at refcount 0
+
+        void printStats();
+
+        int hits = 0;
+        int misses = 0;
+        long long bytesResident = 0;                                        //GPU bytes of unique textures (compressed size for DDS)
+        long long bytesSaved = 0;                                           //GPU bytes not uploaded thanks to hits
+
+    protected:
+
+    private:
+        _textureCache();
+        virtual ~_textureCache();
+
+        struct cacheEntry
+        {
+            GLuint id;
+            unsigned long long hash;
+            int width, height;
+            long long bytes;                                                //as uploaded, mips and compression included
+            int refCount;
+            std::vector<std::string> paths;                                 //every name that resolved here
+        };
+
+        std::unordered_map<std::string, GLuint> byPath;
+        std::unordered_map<unsigned long long, GLuint> byHash;
+        std::unordered_map<GLuint, cacheEntry> entries;
+
+        std::mutex lock;
+};
+
+#endif // _TEXTURECACHE_H
@@ -3,24 +3,39 @@
 
 #include <_common.h>
 #include <SOIL2.h>
+#include <_textureStreamer.h>
+#include <_textureCache.h>
+#include <_textureResidency.h>
+#include <vector>
 
 class _textureLoader
 {
     public:
         _textureLoader();
-        virtual ~_textureLoader();
+        virtual ~_textureLoader();              //releases every cached texture this loader acquired
 
         GLuint loadTexture(char *);               //to read img file
         void bindTexture();                     //to bind img to a model
 
+        static unsigned char *decodeTexture(const unsigned char *, int, int *, int *);   //CPU only, safe on worker threads
+        GLuint uploadTexture(unsigned char *, int, int);                    //GL thread only, pixels are RGBA
+        GLuint streamTexture(unsigned char *, int, int, _textureStreamer *);//GL thread, rows arrive over the next frames
+        bool uploadDDS(const unsigned char *, size_t);                      //GL thread, baked mip chain from _textureBaker
+        static int specifyDDS(GLuint, const unsigned char *, size_t, int, int *, int *, long long *);   //into existing id, skipping top mips
+
+        bool acquireCached(const std::string &, unsigned long long);        //canonical path, content hash
+        void addToCache(const std::string &, unsigned long long, const char *);  //register textID after an upload
+
         unsigned char *image;                   //to handle img data
         int width, height;                      //img width and height
+        long long residentBytes;                //GPU bytes of the last upload, mips included
 
         GLuint textID;                          //img data buffer handler
 
     protected:
 
     private:
+        std::vector<GLuint> owned;              //cache references held by this loader
 };
 
 #endif // _TEXTURELOADER_H
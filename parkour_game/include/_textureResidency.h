@@ -0,0 +1,94 @@
+#ifndef _TEXTURERESIDENCY_H
+#define _TEXTURERESIDENCY_H
+
+#include <_common.h>
+#include <_threadPool.h>
+#include <_textureStreamer.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// Keeps texture memory under a global budget. Every tracked texture knows
+// its size and when it was last bound; when the total goes over budget the
+// least recently bound ones first lose their top mips, then get replaced by
+// a 1x1 placeholder. Texture ids never change: bind() asks for a reload,
+// a worker reads the baked .dds or decodes the source image, and the next
+// beginFrame() uploads it (RGBA through a PBO streamer), so the render
+// thread never waits on the disk or the decoder. Until then the placeholder
+// or the dropped mips stay bound.
+class _textureResidency
+{
+    public:
+        static _textureResidency *instance();
+
+        void track(GLuint, const char *, long long);        //id, source file, bytes
+        void untrack(GLuint);
+        void setPinned(GLuint, bool);                       //pinned textures are never evicted
+
+        void bind(GLuint);                                  //glBindTexture + LRU touch + queue a reload if evicted
+        void beginFrame();                                  //once per frame before drawing: finishes reloads, enforces the budget
+
+        void printStats();
+
+        long long budgetBytes = 256LL * 1024 * 1024;
+        long long residentBytes = 0;
+
+        int maxDropLevels = 2;                              //top mips dropped before a full eviction
+        int minDropSize = 64;                               //never drop below this many texels per side
+
+        int drops = 0, evictions = 0, reloads = 0;
+
+        bool asyncReloads = true;                           //false: decode and upload inside bind()/beginFrame()
+
+    protected:
+
+    private:
+        _textureResidency();
+        virtual ~_textureResidency();
+
+        struct residentTexture
+        {
+            GLuint id;
+            std::string source;
+            long long fullBytes;                            //bytes with nothing dropped
+            long long bytes;                                //bytes resident right now
+            int width, height;                              //full size level 0
+            int dropped;                                    //top mips currently dropped
+            bool evicted;
+            bool pinned;
+            bool reloading;                                 //a worker is preparing it
+            long long expectedBytes;                        //size once the pending reload lands
+            unsigned int lastUsed;                          //frame of the last bind
+            unsigned int generation;                        //new on every track(), so a reused id never takes an old result
+        };
+
+        struct reloadResult
+        {
+            GLuint id;
+            unsigned int generation;                        //of the texture that asked
+            int dropLevels;
+            std::vector<unsigned char> dds;                 //baked file, when there is a current one
+            unsigned char *pixels;                          //else SOIL pixels at the dropped size
+            int width, height;
+        };
+
+        void enforceBudget();
+        void requestReload(residentTexture &, int);         //mip bias; on a worker when asyncReloads is set
+        void finishReloads();                               //GL thread
+        static void prepareReload(reloadResult *, const std::string &, int);   //worker: file I/O and decode
+        bool respecify(residentTexture &, int);             //inline reload at a mip bias, false if the source is gone
+        void evict(residentTexture &);
+
+        std::unordered_map<GLuint, residentTexture> textures;
+        unsigned int frame = 0;
+        unsigned int generations = 0;
+
+        _threadPool *workers = nullptr;                     //created on the first async reload
+        _textureStreamer *streamer = nullptr;
+        std::vector<reloadResult *> finished;               //filled by workers, drained by finishReloads()
+        std::mutex finishedLock;
+        long long pendingBytes = 0;                         //expected - current bytes over every pending reload
+};
+
+#endif // _TEXTURERESIDENCY_H
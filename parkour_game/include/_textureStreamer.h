@@ -0,0 +1,61 @@
+#ifndef _TEXTURESTREAMER_H
+#define _TEXTURESTREAMER_H
+
+#include <_common.h>
+#include <deque>
+#include <vector>
+
+// Uploads decoded RGBA images a few rows at a time through a ring of
+// orphaned pixel buffer objects, so no single frame pays for a whole
+// glTexImage2D. Call update() once per frame on the GL thread.
+// Replacing an existing texture collects the rows in a staging buffer
+// instead and swaps level 0 in one call at the end, so the old image
+// stays bound until the new one is complete.
+class _textureStreamer
+{
+    public:
+        _textureStreamer(int budgetBytes = 4 * 1024 * 1024, int numBuffers = 3);
+        virtual ~_textureStreamer();
+
+        GLuint queueTexture(unsigned char *, int, int);     //takes ownership of SOIL pixels, returns texture id now
+        void queueInto(GLuint, unsigned char *, int, int);  //same, into an existing texture; its old levels stay until the last row is in
+        void update();                                      //upload up to bytesPerFrame
+
+        static void cancel(GLuint);                         //every streamer drops what it still has queued for a texture about to be deleted
+
+        bool isStreaming(GLuint);                           //texture still has rows queued
+        bool isIdle();
+
+        int bytesPerFrame;                                  //per frame upload budget
+        int bytesQueued;                                    //bytes still waiting
+
+    protected:
+
+    private:
+        struct pendingUpload
+        {
+            GLuint tex;
+            unsigned char *pixels;
+            int width, height;
+            int nextRow;                                    //first row not yet uploaded
+            bool replace;                                   //queueInto: rows go to staging, level 0 is swapped at the end
+            GLuint staging;                                 //whole-image PBO for a replace, 0 until the first rows
+        };
+
+        void initBuffers();
+        void uploadRows(pendingUpload &, int, int);         //upload, first row, row count
+        void stageRows(pendingUpload &, int, int);          //replace: copy rows into the staging buffer
+        void finishReplace(pendingUpload &);                //replace: level 0 from the staging buffer in one call
+        void drop(GLuint);
+
+        static std::vector<_textureStreamer *> &live();     //every streamer, for cancel()
+
+        std::deque<pendingUpload> queue;
+
+        int bufferCount;
+        GLuint *pbo;
+        int nextBuffer;
+        bool usePBO;
+};
+
+#endif // _TEXTURESTREAMER_H
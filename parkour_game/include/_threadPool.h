@@ -0,0 +1,40 @@
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <_common.h>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class _threadPool
+{
+    public:
+        _threadPool(int numThreads = 0);                    //0 = one worker per spare core
+        virtual ~_threadPool();
+
+        void submit(std::function<void()> job);             //queue a job for any worker
+        void waitAll();                                     //block until the queue is drained
+
+        int threadCount();                                  //number of worker threads
+        int workerIndex();                                  //index of calling worker, -1 on other threads
+
+    protected:
+
+    private:
+        void workerLoop(int index);
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+
+        std::mutex lock;
+        std::condition_variable jobReady;                   //signalled when a job is queued
+        std::condition_variable jobsDone;                   //signalled when pending hits zero
+
+        int pending = 0;                                    //queued + running jobs
+        bool stopping = false;
+};
+
+#endif // _THREADPOOL_H
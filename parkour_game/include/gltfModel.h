@@ -9,17 +9,23 @@
 #include <GL/gl.h>
 #include <_common.h>
 #include <cgltf.h>
+#include <_textureResidency.h>
+#include <_animClip.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
 
+class _animInstance;
+
 struct Triangle {
     vec3 a, b, c;
 };
 
 class GltfModel {
 public:
+    ~GltfModel();
+
     // geometry
     std::vector<float> vertices;    // x,y,z
     std::vector<float> normals;     // nx,ny,nz
@@ -27,29 +33,84 @@ public:
     std::vector<unsigned int> indices;
     std::vector<Triangle> triangles;
 
-
+    // skinning: JOINTS_0 / WEIGHTS_0 against the first skin, empty for rigid models
+    std::vector<unsigned short> joints;     // 4 per vertex, index into skinJoints
+    std::vector<float> weights;             // 4 per vertex
+    std::vector<int> skinJoints;            // node index of each joint
+    std::vector<glm::mat4> inverseBindMatrices;
+    bool isSkinned() const { return !skinJoints.empty() && joints.size() == vertices.size() / 3 * 4; }
+
+    // morph targets: POSITION/NORMAL deltas, each trimmed to the vertex range it moves
+    struct MorphTarget {
+        int weight;                         // slot in the weight array
+        int firstVertex;
+        int vertexCount;
+        std::vector<float> dx, dy, dz;      // position deltas, one stream per axis
+        std::vector<float> nx, ny, nz;      // normal deltas, empty if the target has none
+    };
+    std::vector<MorphTarget> morphTargets;
+    std::vector<float> morphWeights;        // default weight per slot, from mesh.weights
+    std::vector<int> morphSlot;             // first weight slot of each node's mesh, -1 without targets
+    bool hasMorphs() const { return !morphTargets.empty(); }
+
+    // bounds in model space (bind pose for skinned models, widened to cover morph targets)
+    struct Bounds {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+        glm::vec3 center = glm::vec3(0.0f);  // of the box; the sphere shares it
+        float radius = 0.0f;
+    };
+    struct Submesh {                        // one triangle primitive, in load order
+        int firstVertex, vertexCount;
+        int firstIndex, indexCount;
+        Bounds bounds;
+    };
+    Bounds bounds;
+    std::vector<Submesh> submeshes;
 
     // GL handles
     GLuint vbo = 0;
     GLuint nbo = 0;
     GLuint tbo = 0;
     GLuint ebo = 0;
+    GLuint jbo = 0;                 // JOINTS_0, skinned models only
+    GLuint wbo = 0;                 // WEIGHTS_0, skinned models only
     GLuint textureID = 0;
 
+    // embedded base color image decoded by _gltfLoader::parseModel(), freed once uploaded
+    unsigned char* embeddedImage = nullptr;
+    int embeddedWidth = 0;
+    int embeddedHeight = 0;
+    unsigned long long embeddedHash = 0;        // content hash for _textureCache
+    GLuint embeddedTexture = 0;                 // this model's _textureCache reference, released in the destructor
+
     // cgltf data pointer (owned by this model or by loader; do NOT free data while this model uses it)
     cgltf_data* data = nullptr;
 
-    // node transform caches (one per cgltf node, filled in computeGlobalTransforms())
-    std::vector<glm::mat4> nodeLocalTransforms;
-    std::vector<glm::mat4> nodeGlobalTransforms;
+    // ---- Shared, read-only once loaded; per-instance state lives in _animInstance ----
+    std::vector<_animClip*> clips;                          // decoded once from data->animations
+    std::vector<nodeTRS_t> restPose;                        // one per cgltf node, copied into each instance
+
+    // flat hierarchy from buildHierarchy(): parents always come before their children
+    std::vector<int> hierNode;                              // node index at each position
+    std::vector<int> hierParent;                            // parent node index, -1 for roots
+
+    void buildAnimationClips();                             // decode animations into clips (call once after loading)
+    void buildHierarchy();                                  // flatten the node tree, parents first (call once after loading)
+    void computeBounds();                                   // model and submesh bounds from the vertices (call once after loading)
+    void compressAnimationClips(float tolerance);           // key reduction + 48-bit keys, prints ratio and max error per clip
+    glm::mat4 computeLocalMatrix(size_t nodeIndex, const nodeTRS_t& trs) const;
 
-    // animation helpers
-    void updateAnimation(float timeInSeconds);             // public: advance animation (seconds)
-    void applyAnimationToNodes(float timeInSeconds);       // apply keyframes to cgltf nodes
+    // the model's own pose, for code that animates a single copy directly
+    void updateAnimation(float timeInSeconds);              // sample clip 0 at an absolute time (seconds)
+    const glm::mat4* rootTransform() const;                 // node 0 global transform, null until animated
 
     // GPU
     void uploadToGPU();
-    void draw();
+    void draw();                                            // under rootTransform()
+    void drawGeometry(GLuint skinnedVBO = 0, GLsizei instances = 1);   // buffers only, caller sets the transform; skinnedVBO replaces positions/normals
+    void drawInstanced(const std::vector<glm::mat4>& matrices,         // one draw call for every copy (world matrices, colours;
+                       const std::vector<glm::vec4>& colors);          // white if short), one draw per copy without instancing
 
     // utility: set cgltf_data pointer (call this if loader returned data and you want model to keep it)
     void setCgltfData(cgltf_data* d);
@@ -57,14 +118,6 @@ public:
     void buildTriangleList();
 
 private:
-    glm::mat4 computeLocalMatrix(const cgltf_node* node) const;
-    void computeGlobalTransforms(); // populates nodeGlobalTransforms by walking scene graph
-    // small helper to find node index by pointer
-    void ensureNodeTransformArrays();
-
-    // helper to sample accessor floats and vec components
-    float readAccessorFloat(const cgltf_accessor* acc, size_t index) const;
-    void readAccessorVec3(const cgltf_accessor* acc, size_t index, float out3[3]) const;
-    void readAccessorQuat(const cgltf_accessor* acc, size_t index, float out4[4]) const;
+    _animInstance* ownInstance = nullptr;
 };
 //new
@@ -19,6 +19,8 @@
 #include <_Scene.h>
 #include <_mainMenu.h>
 #include <_sounds.h>
+#include <_textureBaker.h>
+#include <_animationSystem.h>
 
 _Scene *myScene = new _Scene();     //create scene class instance
 _mainMenu *myMenu = new _mainMenu();
@@ -253,6 +255,9 @@ BOOL CreateGLWindow(char* title, int width, int height, int bits, bool fullscree
 	myMenu->initGL();
 	myMenu->reSizeScene(width, height);
 
+	_textureCache::instance()->printStats();               //dedup hits across scene, menu and models
+	_textureResidency::instance()->printStats();
+
 	//ShowCursor(FALSE);
 
 	return TRUE;							                // Success
@@ -362,6 +367,57 @@ int WINAPI WinMain(
  	MSG	msg;					        // Windows Message Structure
 	BOOL	done=FALSE;				    // Bool Variable To Exit Loop
 
+	// Offline texture bake: "parkour_game.exe -bake" writes .dds files next to the images and exits
+	if (lpCmdLine && strstr(lpCmdLine, "-bake"))
+	{
+		_textureBaker baker;
+		baker.bakeDirectory("images", _textureBaker::AUTO);
+		baker.bakeDirectory("models/Tekk", _textureBaker::AUTO);
+		return 0;
+	}
+
+	// Animation benchmark: "parkour_game.exe -animbench [model.glb]" prints the 1..N thread speedup,
+	// then compresses the clips and runs again to show the cost of decoding packed keys, and exits
+	if (lpCmdLine && strstr(lpCmdLine, "-animbench"))
+	{
+		char path[MAX_PATH] = "models/cuberotate.glb";
+		sscanf(strstr(lpCmdLine, "-animbench") + 10, " %259s", path);     // optional model after the flag
+
+		_gltfLoader loader;
+		GltfModel *model = loader.parseModel(path);                        // CPU data only, no GL context needed
+		_animationSystem::benchmark(model, 2000, 200);
+
+		if (model) {
+			model->compressAnimationClips(0.001f);
+			_animationSystem::benchmark(model, 2000, 200);
+		}
+		delete model;
+		return 0;
+	}
+
+	// MD2 benchmark: "parkour_game.exe -md2bench [model.md2]" times scalar vs SSE frame interpolation and exits
+	if (lpCmdLine && strstr(lpCmdLine, "-md2bench"))
+	{
+		char path[MAX_PATH] = "models/Tekk/tris.md2";
+		sscanf(strstr(lpCmdLine, "-md2bench") + 9, " %259s", path);
+
+		_3DModelLoader md2;
+		if (md2.ReadMD2Model(path, &md2.md2file)) md2.BenchmarkInterpolation(20000);
+		return 0;
+	}
+
+	// Visibility bake: "parkour_game.exe -pvs" writes models/level.pvs for the static level, prints
+	// bake time, size and draw reduction, and exits (not "-pvsbake": that would also match "-bake")
+	if (lpCmdLine && strstr(lpCmdLine, "-pvs"))
+	{
+		myScene->bakePVS();
+		return 0;
+	}
+
+	// Animation demo: "parkour_game.exe -animdemo" adds a row of animated cubes to the level
+	// and prints how many updates animation LOD skipped every couple of seconds
+	if (lpCmdLine && strstr(lpCmdLine, "-animdemo")) myScene->animDemo = true;
+
 	int	fullscreenWidth  = GetSystemMetrics(SM_CXSCREEN);
     int	fullscreenHeight = GetSystemMetrics(SM_CYSCREEN);
 
@@ -408,6 +464,7 @@ int WINAPI WinMain(
 			else				        // Not Time To Quit, Update Screen
 			{
 			    myTimer.updateDeltaTime();                // UPDATE deltaTime ONCE PER FRAME
+			    _textureResidency::instance()->beginFrame();  // land finished texture reloads, evict LRU textures if over the VRAM budget
 
                 POINT center;
 
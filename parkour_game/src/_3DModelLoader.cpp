@@ -1,10 +1,39 @@
 #include "_3DModelLoader.h"
 #include <_Scene.h>
 #include <gltfModel.h>
+#include <_gpuMD2.h>
+#include <_md2Instance.h>
+#include <map>
+#include <chrono>
+#include <emmintrin.h>
+
+/* anorms_table padded to 4 floats and 256 entries, so any normalIndex byte is a safe aligned load.
+   Built on first use; both asset loader workers may get here at once, which a local static handles */
+struct md2_normalTable_t
+{
+  alignas (16) float n[256][4];
+
+  md2_normalTable_t ()
+  {
+    static const vec3_t anorms[162] = {
+      #include "Anorms.h"
+    };
+    for (int i = 0; i < 256; ++i)
+      for (int c = 0; c < 4; ++c)
+	n[i][c] = (i < 162 && c < 3) ? anorms[i][c] : 0.0f;
+  }
+};
+
+static const float (*normalTable ())[4]
+{
+  static const md2_normalTable_t table;
+  return table.n;
+}
 
 _3DModelLoader::_3DModelLoader()
 {
     //ctor
+    memset(&md2file, 0, sizeof(md2file));
 
     pos.x = 0;
     pos.y = 10;
@@ -14,78 +43,207 @@ _3DModelLoader::_3DModelLoader()
 _3DModelLoader::~_3DModelLoader()
 {
     //dtor
+    delete ownInstance;
     FreeModel(&md2file);
+
+    if (vboFrame) glDeleteBuffers(1, &vboFrame);
+    if (vboTexCoords) glDeleteBuffers(1, &vboTexCoords);
+    if (iboMesh) glDeleteBuffers(1, &iboMesh);
+    if (vboFrames) glDeleteBuffers(1, &vboFrames);
+    if (frameBuffer) _mm_free(frameBuffer);
 }
 
 int _3DModelLoader::ReadMD2Model(const char* filename, struct md2_model_t* mdl)
 {
-  FILE *fp;
-
-  fp = fopen (filename, "rb");
-  if (!fp)
+  /* Map the whole file; ParseMD2 copies what it needs, so the view is dropped right after */
+  HANDLE file = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
     {
       fprintf (stderr, "Error: couldn't open \"%s\"!\n", filename);
       return 0;
     }
 
+  LARGE_INTEGER size;
+  size.QuadPart = 0;
+  GetFileSizeEx (file, &size);
+
+  HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingA (file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+  const unsigned char *data = mapping ? (const unsigned char *)MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+
+  int ok = 0;
+  if (data)
+    ok = ParseMD2 (data, (size_t)size.QuadPart, mdl);
+  else
+    fprintf (stderr, "Error: couldn't map \"%s\"!\n", filename);
+
+  if (data)
+    UnmapViewOfFile (data);
+  if (mapping)
+    CloseHandle (mapping);
+  CloseHandle (file);
+
+  if (!ok)
+    return 0;
+
+  EndFrame = mdl->header.num_frames-1;
+
+  BuildIndexedMesh (mdl);
+  return 1;
+}
+
+/* true if count elements of elemSize bytes at offset lie inside the file */
+static bool md2SectionFits (int offset, int count, size_t elemSize, size_t fileSize)
+{
+  if ((offset < 0) || (count < 0))
+    return false;
+  return (unsigned long long)offset + (unsigned long long)count * elemSize <= fileSize;
+}
+
+static size_t md2Align (size_t n)
+{
+  return (n + 15) & ~(size_t)15;
+}
+
+int _3DModelLoader::ParseMD2(const unsigned char* data, size_t size, struct md2_model_t* mdl)
+{
   /* Read header */
-  fread (&mdl->header, 1, sizeof (struct md2_header_t), fp);
+  if (size < sizeof (struct md2_header_t))
+    {
+      fprintf (stderr, "Error: file too small for an MD2 header\n");
+      return 0;
+    }
+  /* Validate into a local copy; a bad reload must not touch the model already loaded */
+  struct md2_header_t header;
+  memcpy (&header, data, sizeof (struct md2_header_t));
 
-  if ((mdl->header.ident != 844121161) ||
-      (mdl->header.version != 8))
+  const struct md2_header_t *h = &header;
+  if ((h->ident != 844121161) || (h->version != 8))
     {
       /* Error! */
       fprintf (stderr, "Error: bad version or identifier\n");
-      fclose (fp);
       return 0;
     }
 
-  /* Memory allocations */
-  mdl->skins = (struct md2_skin_t *)malloc (sizeof (struct md2_skin_t) * mdl->header.num_skins);
-  mdl->texcoords = (struct md2_texCoord_t *)malloc (sizeof (struct md2_texCoord_t) * mdl->header.num_st);
-  mdl->triangles = (struct md2_triangle_t *)malloc (sizeof (struct md2_triangle_t) * mdl->header.num_tris);
-  mdl->frames = (struct md2_frame_t *)malloc (sizeof (struct md2_frame_t) * mdl->header.num_frames);
-  mdl->glcmds = (int *)malloc (sizeof (int) * mdl->header.num_glcmds);
+  /* Every section inside the file; a frame is scale, translate, name, then its vertices */
+  const size_t frameHeader = sizeof (vec3_t) * 2 + 16;
+  if (!md2SectionFits (h->offset_skins, h->num_skins, sizeof (struct md2_skin_t), size)
+      || !md2SectionFits (h->offset_st, h->num_st, sizeof (struct md2_texCoord_t), size)
+      || !md2SectionFits (h->offset_tris, h->num_tris, sizeof (struct md2_triangle_t), size)
+      || !md2SectionFits (h->offset_glcmds, h->num_glcmds, sizeof (int), size)
+      || !md2SectionFits (h->offset_frames, h->num_frames, h->framesize, size)
+      || (h->num_frames < 1) || (h->num_vertices < 1)
+      || ((unsigned long long)h->framesize < frameHeader + (unsigned long long)h->num_vertices * sizeof (struct md2_vertex_t)))
+    {
+      fprintf (stderr, "Error: MD2 section out of range\n");
+      return 0;
+    }
 
-  /* Read model data */
-  fseek (fp, mdl->header.offset_skins, SEEK_SET);
-  fread (mdl->skins, sizeof (struct md2_skin_t),mdl->header.num_skins, fp);
+  /* Triangles and glcmds must only reference vertices and texcoords that exist */
+  const struct md2_triangle_t *tris = (const struct md2_triangle_t *)(data + h->offset_tris);
+  for (int i = 0; i < h->num_tris; ++i)
+    for (int j = 0; j < 3; ++j)
+      if ((tris[i].vertex[j] >= h->num_vertices) || (tris[i].st[j] >= h->num_st))
+	{
+	  fprintf (stderr, "Error: MD2 triangle %d out of range\n", i);
+	  return 0;
+	}
 
-  fseek (fp, mdl->header.offset_st, SEEK_SET);
-  fread (mdl->texcoords, sizeof (struct md2_texCoord_t),mdl->header.num_st, fp);
+  bool valid = true;
+  const int *cmd = (const int *)(data + h->offset_glcmds);
+  const int *end = cmd + h->num_glcmds;
+  for (;;)
+    {
+      /* the list must end with a 0 inside num_glcmds (or be empty) */
+      if (cmd >= end)
+	{
+	  valid = h->num_glcmds == 0;
+	  break;
+	}
 
-  fseek (fp, mdl->header.offset_tris, SEEK_SET);
-  fread (mdl->triangles, sizeof (struct md2_triangle_t),mdl->header.num_tris, fp);
+      int count = *(cmd++);
+      if (count == 0)
+	break;
+      if (count < 0)
+	count = -count;
 
-  fseek (fp, mdl->header.offset_glcmds, SEEK_SET);
-  fread (mdl->glcmds, sizeof (int), mdl->header.num_glcmds, fp);
+      if ((end - cmd) / 3 < count)
+	{
+	  valid = false;
+	  break;
+	}
+      for (int k = 0; k < count; ++k, cmd += 3)
+	if ((cmd[2] < 0) || (cmd[2] >= h->num_vertices))
+	  valid = false;
+      if (!valid)
+	break;
+    }
+  if (!valid)
+    {
+      fprintf (stderr, "Error: MD2 glcmds malformed\n");
+      return 0;
+    }
 
-  /* Read frames */
-  fseek (fp, mdl->header.offset_frames, SEEK_SET);
-  for (int i = 0; i < mdl->header.num_frames; ++i)
+  /* One arena: frame table, skins, texcoords, triangles, glcmds, then every frame's vertices */
+  size_t frameVerts = sizeof (struct md2_vertex_t) * h->num_vertices;
+  size_t sizes[6] = {
+    sizeof (struct md2_frame_t) * h->num_frames,
+    sizeof (struct md2_skin_t) * h->num_skins,
+    sizeof (struct md2_texCoord_t) * h->num_st,
+    sizeof (struct md2_triangle_t) * h->num_tris,
+    sizeof (int) * h->num_glcmds,
+    frameVerts * h->num_frames
+  };
+  size_t total = 0;
+  for (int i = 0; i < 6; ++i)
+    total += md2Align (sizes[i]);
+
+  /* 16-byte aligned, so every md2Align'd section starts on a vector boundary */
+  unsigned char *arena = (unsigned char *)_mm_malloc (total, 16);
+  if (!arena)
+    return 0;
+
+  FreeModel (mdl);
+  mdl->header = header;
+
+  unsigned char *p = arena;
+  mdl->arena = arena;
+  mdl->frames = (struct md2_frame_t *)p;          p += md2Align (sizes[0]);
+  mdl->skins = (struct md2_skin_t *)p;            p += md2Align (sizes[1]);
+  mdl->texcoords = (struct md2_texCoord_t *)p;    p += md2Align (sizes[2]);
+  mdl->triangles = (struct md2_triangle_t *)p;    p += md2Align (sizes[3]);
+  mdl->glcmds = (int *)p;                         p += md2Align (sizes[4]);
+  struct md2_vertex_t *verts = (struct md2_vertex_t *)p;
+
+  memcpy (mdl->skins, data + h->offset_skins, sizes[1]);
+  memcpy (mdl->texcoords, data + h->offset_st, sizes[2]);
+  memcpy (mdl->triangles, data + h->offset_tris, sizes[3]);
+  memcpy (mdl->glcmds, data + h->offset_glcmds, sizes[4]);
+
+  for (int i = 0; i < h->num_frames; ++i)
     {
-      /* Memory allocation for vertices of this frame */
-      mdl->frames[i].verts = (struct md2_vertex_t *)malloc (sizeof (struct md2_vertex_t) * mdl->header.num_vertices);
+      const unsigned char *src = data + h->offset_frames + (size_t)i * h->framesize;
+      struct md2_frame_t *frame = &mdl->frames[i];
 
-      /* Read frame data */
-      fread (mdl->frames[i].scale, sizeof (vec3_t), 1, fp);
-      fread (mdl->frames[i].translate, sizeof (vec3_t), 1, fp);
-      fread (mdl->frames[i].name, sizeof (char), 16, fp);
-      fread (mdl->frames[i].verts, sizeof (struct md2_vertex_t),mdl->header.num_vertices, fp);
+      memcpy (frame->scale, src, sizeof (vec3_t));
+      memcpy (frame->translate, src + sizeof (vec3_t), sizeof (vec3_t));
+      memcpy (frame->name, src + sizeof (vec3_t) * 2, 16);
+      frame->name[15] = '\0';
 
-      cout<<mdl->frames[i].name<<endl;
+      frame->verts = verts + (size_t)i * h->num_vertices;
+      memcpy (frame->verts, src + frameHeader, frameVerts);
     }
 
+  return 1;
+}
+
+void _3DModelLoader::loadSkins(struct md2_model_t* mdl)
+{
     for(int i =0; i<mdl->header.num_skins; i++){
         cout<<mdl->skins[i].name<<endl;
         myTex->loadTexture("models/Tekk/blade.jpg");
         mdl->tex_id = myTex->textID;
     }
-     EndFrame = mdl->header.num_frames-1;
-
-  fclose (fp);
-  return 1;
-
 }
 
 void _3DModelLoader::RenderFrame(int n, const struct md2_model_t* mdl)
@@ -96,7 +254,7 @@ void _3DModelLoader::RenderFrame(int n, const struct md2_model_t* mdl)
     return;
 
   /* Enable model's texture */
-  glBindTexture (GL_TEXTURE_2D, mdl->tex_id);
+  _textureResidency::instance()->bind (mdl->tex_id);
 
   /* Draw the model */
   glBegin (GL_TRIANGLES);
@@ -139,7 +297,7 @@ void _3DModelLoader::RenderFrameItpWithGLCmds(int n, float interp, const struct
     return;
 
   /* Enable model's texture */
-  glBindTexture (GL_TEXTURE_2D, mdl->tex_id);
+  _textureResidency::instance()->bind (mdl->tex_id);
 
   /* pglcmds points at the start of the command list */
   pglcmds = mdl->glcmds;
@@ -199,123 +357,354 @@ void _3DModelLoader::RenderFrameItpWithGLCmds(int n, float interp, const struct
 
 }
 
-void _3DModelLoader::Animate(int start, int end, int* frame, float* interp)
+void _3DModelLoader::BuildIndexedMesh(const struct md2_model_t* mdl)
 {
+  meshVerts.clear ();
+  meshIndices.clear ();
+  if (!mdl->glcmds)
+    return;
 
-    if ((*frame < start) || (*frame > end))
-    *frame = start;
+  /* Same vertex with the same texture coordinates -> same mesh vertex */
+  std::map<std::pair<int, std::pair<float, float> >, unsigned short> lookup;
+  std::vector<unsigned short> group;
 
-    if (*interp >= 1.0f)
+  const int *cmd = mdl->glcmds;
+  const int *end = mdl->glcmds + mdl->header.num_glcmds;
+
+  while (cmd < end && *cmd != 0)
     {
-      /* Move to next frame */
-      *interp = 0.0f;
-      (*frame)++;
+      int count = *(cmd++);
+      bool fan = count < 0;
+      if (fan)
+	count = -count;
 
-      if (*frame >= end)
-	*frame = start;
+      if (cmd + count * 3 > end)
+	break;
+
+      group.clear ();
+      for (int k = 0; k < count; ++k, cmd += 3)
+	{
+	  struct md2_glcmd_t packet = *(const struct md2_glcmd_t *)cmd;
+	  if ((packet.index < 0) || (packet.index >= mdl->header.num_vertices))
+	    packet.index = 0;
+
+	  std::pair<int, std::pair<float, float> > key (packet.index, std::make_pair (packet.s, packet.t));
+	  std::map<std::pair<int, std::pair<float, float> >, unsigned short>::iterator it = lookup.find (key);
+	  if (it == lookup.end ())
+	    {
+	      it = lookup.insert (std::make_pair (key, (unsigned short)meshVerts.size ())).first;
+	      meshVerts.push_back (packet);
+	    }
+	  group.push_back (it->second);
+	}
+
+      /* Fans pivot on the first vertex; strips flip winding every other triangle */
+      for (int k = 2; k < count; ++k)
+	{
+	  unsigned short a = fan ? group[0] : (k % 2 == 0 ? group[k - 2] : group[k - 1]);
+	  unsigned short b = fan ? group[k - 1] : (k % 2 == 0 ? group[k - 1] : group[k - 2]);
+
+	  meshIndices.push_back (a);
+	  meshIndices.push_back (b);
+	  meshIndices.push_back (group[k]);
+	}
     }
 
+  if (frameBuffer)
+    _mm_free (frameBuffer);
+  frameBuffer = (float *)_mm_malloc (sizeof (float) * 8 * (meshVerts.empty () ? 1 : meshVerts.size ()), 16);
+  normalTable ();                                    /* built here, off the render thread */
 }
 
-void _3DModelLoader::initModel(const char* filename)
+void _3DModelLoader::UploadBuffers()
 {
+  if (meshIndices.empty () || iboMesh)
+    return;
 
-    /* Load MD2 model file */
-    if (!ReadMD2Model (filename, &md2file))
-    exit (EXIT_FAILURE);
+  std::vector<float> st (meshVerts.size () * 2);
+  for (size_t k = 0; k < meshVerts.size (); ++k)
+    {
+      st[k * 2 + 0] = meshVerts[k].s;
+      st[k * 2 + 1] = meshVerts[k].t;
+    }
 
+  glGenBuffers (1, &vboTexCoords);
+  glBindBuffer (GL_ARRAY_BUFFER, vboTexCoords);
+  glBufferData (GL_ARRAY_BUFFER, st.size () * sizeof (float), st.data (), GL_STATIC_DRAW);
 
-}
+  /* Filled every frame by RenderFrameItpWithVBO */
+  glGenBuffers (1, &vboFrame);
+  glBindBuffer (GL_ARRAY_BUFFER, vboFrame);
+  glBufferData (GL_ARRAY_BUFFER, meshVerts.size () * 8 * sizeof (float), NULL, GL_STREAM_DRAW);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
 
-void _3DModelLoader::Draw(/**float xPos, float yPos, float zPos, float angle, float xRot, float yRot, float zRot**/)
-{
-  static int n = 0; /* The current frame */
-  static float interp = 0.0;
-  static double curent_time = 0;
-  static double last_time = 0;
+  glGenBuffers (1, &iboMesh);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, iboMesh);
+  glBufferData (GL_ELEMENT_ARRAY_BUFFER, meshIndices.size () * sizeof (unsigned short), meshIndices.data (), GL_STATIC_DRAW);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
 
-  last_time = curent_time;
-  curent_time = (double)glutGet (GLUT_ELAPSED_TIME) / 1000.0;
+  if (!_shader::supported ())
+    return;
 
-  /* Animate model from frames 0 to num_frames-1 */
-  interp += 10 * (curent_time - last_time);
-  Animate (StartFrame, EndFrame, &n, &interp);
+  /* Every frame, per mesh vertex, for the vertex shader: u8 x,y,z as stored, normal as signed bytes */
+  const float (*table)[4] = normalTable ();
+  std::vector<signed char> frames (md2file.header.num_frames * meshVerts.size () * 8, 0);
+  signed char *out = frames.data ();
 
+  for (int f = 0; f < md2file.header.num_frames; ++f)
+    for (size_t k = 0; k < meshVerts.size (); ++k, out += 8)
+      {
+	const struct md2_vertex_t *vert = &md2file.frames[f].verts[meshVerts[k].index];
+	memcpy (out, vert->v, 3);
+	for (int c = 0; c < 3; ++c)
+	  out[4 + c] = (signed char)lrintf (table[vert->normalIndex][c] * 127.0f);
+      }
+
+  glGenBuffers (1, &vboFrames);
+  glBindBuffer (GL_ARRAY_BUFFER, vboFrames);
+  glBufferData (GL_ARRAY_BUFFER, frames.size (), frames.data (), GL_STATIC_DRAW);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
 
+void _3DModelLoader::RenderFrameItpWithVBO(int n, float interp, const struct md2_model_t* mdl)
+{
 
+  /* Check if n is in a valid range */
+  if ((n < 0) || (n > mdl->header.num_frames - 1) || !iboMesh)
+    return;
 
+  /* Enable model's texture */
+  _textureResidency::instance()->bind (mdl->tex_id);
 
-  //glTranslatef (0.0f, 4.0f, -100.0f);
-  //glRotatef (-90.0f, 1.0, 0.0, 0.0);
-  //glRotatef (-90.0f, 0.0, 0.0, 1.0);
+  pframe1 = &mdl->frames[n];
+  pframe2 = &mdl->frames[n + 1 < mdl->header.num_frames ? n + 1 : n];
 
-  ///glTranslatef(xPos, yPos, zPos);
-  ///glRotatef(angle, xRot, yRot, zRot);
+  InterpolateFramesSSE (pframe1, pframe2, interp, frameBuffer);
 
+  /* Orphan last frame's storage, then stream this one */
+  size_t size = meshVerts.size () * 8 * sizeof (float);
+  glBindBuffer (GL_ARRAY_BUFFER, vboFrame);
+  glBufferData (GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBufferSubData (GL_ARRAY_BUFFER, 0, size, frameBuffer);
 
+  glEnableClientState (GL_VERTEX_ARRAY);
+  glVertexPointer (3, GL_FLOAT, 8 * sizeof (float), (void *)0);
+  glEnableClientState (GL_NORMAL_ARRAY);
+  glNormalPointer (GL_FLOAT, 8 * sizeof (float), (void *)(4 * sizeof (float)));
 
+  glBindBuffer (GL_ARRAY_BUFFER, vboTexCoords);
+  glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+  glTexCoordPointer (2, GL_FLOAT, 0, (void *)0);
 
+  /* The whole model in one call */
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, iboMesh);
+  glDrawElements (GL_TRIANGLES, (GLsizei)meshIndices.size (), GL_UNSIGNED_SHORT, (void *)0);
 
-  /* Draw the model */
-  // RenderFrame (n, &md2file);
-  // RenderFrameWithGLCmds (n, &md2file);
-  //RenderFrameItp (n, interp, &md2file);
+  glDisableClientState (GL_VERTEX_ARRAY);
+  glDisableClientState (GL_NORMAL_ARRAY);
+  glDisableClientState (GL_TEXTURE_COORD_ARRAY);
+  glBindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+  glBindBuffer (GL_ARRAY_BUFFER, 0);
+}
 
-   RenderFrameItpWithGLCmds (n, interp, &md2file);
+void _3DModelLoader::InterpolateFrames(const struct md2_frame_t* a, const struct md2_frame_t* b, float interp, float* out)
+{
+  for (size_t k = 0; k < meshVerts.size (); ++k, out += 8)
+    {
+      pvert1 = &a->verts[meshVerts[k].index];
+      pvert2 = &b->verts[meshVerts[k].index];
+      n_curr = anorms_table[pvert1->normalIndex];
+      n_next = anorms_table[pvert2->normalIndex];
 
+      for (int c = 0; c < 3; ++c)
+	{
+	  float curr = a->scale[c] * pvert1->v[c] + a->translate[c];
+	  float next = b->scale[c] * pvert2->v[c] + b->translate[c];
+	  out[c] = curr + interp * (next - curr);
+	  out[4 + c] = n_curr[c] + interp * (n_next[c] - n_curr[c]);
+	}
+      out[3] = 1.0f;
+      out[7] = 0.0f;
+    }
 }
 
-void _3DModelLoader::Actions()
+void _3DModelLoader::InterpolateFramesSSE(const struct md2_frame_t* a, const struct md2_frame_t* b, float interp, float* out)
 {
-    switch(actionTrigger)
+  const float (*table)[4] = normalTable ();
+
+  /* Fold scale, translate and the lerp into two multiplies and two adds:
+     pos = va * (scaleA * (1 - t)) + vb * (scaleB * t) + lerp (translateA, translateB, t) */
+  __m128 wa = _mm_set1_ps (1.0f - interp);
+  __m128 wb = _mm_set1_ps (interp);
+  __m128 scaleA = _mm_mul_ps (_mm_setr_ps (a->scale[0], a->scale[1], a->scale[2], 0.0f), wa);
+  __m128 scaleB = _mm_mul_ps (_mm_setr_ps (b->scale[0], b->scale[1], b->scale[2], 0.0f), wb);
+  __m128 offset = _mm_add_ps (_mm_mul_ps (_mm_setr_ps (a->translate[0], a->translate[1], a->translate[2], 0.0f), wa),
+                              _mm_mul_ps (_mm_setr_ps (b->translate[0], b->translate[1], b->translate[2], 0.0f), wb));
+  offset = _mm_add_ps (offset, _mm_setr_ps (0.0f, 0.0f, 0.0f, 1.0f));     /* w = 1 */
+  const __m128i zero = _mm_setzero_si128 ();
+
+  for (size_t k = 0; k < meshVerts.size (); ++k, out += 8)
     {
-        case STAND:  StartFrame = 0;  EndFrame = 39; break;
-        case RUN:    StartFrame = 40; EndFrame = 45; break;
-        case ATTACK: StartFrame = 46; EndFrame = 53; break;
-        case PAIN:   StartFrame = 54; EndFrame = 65; break;
-        case JUMP:   StartFrame = 66; EndFrame = 71; break;
+      const struct md2_vertex_t *va = &a->verts[meshVerts[k].index];
+      const struct md2_vertex_t *vb = &b->verts[meshVerts[k].index];
+
+      /* Widen x,y,z,normalIndex bytes to 32-bit lanes; the normalIndex lane meets a zero scale */
+      int packedA, packedB;
+      memcpy (&packedA, va, 4);
+      memcpy (&packedB, vb, 4);
+      __m128i ia = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (packedA), zero), zero);
+      __m128i ib = _mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 (packedB), zero), zero);
+
+      __m128 pos = _mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_cvtepi32_ps (ia), scaleA),
+                                           _mm_mul_ps (_mm_cvtepi32_ps (ib), scaleB)), offset);
+
+      __m128 na = _mm_load_ps (table[va->normalIndex]);
+      __m128 nb = _mm_load_ps (table[vb->normalIndex]);
+      __m128 nrm = _mm_add_ps (na, _mm_mul_ps (_mm_sub_ps (nb, na), wb));
+
+      _mm_store_ps (out, pos);
+      _mm_store_ps (out + 4, nrm);
     }
 }
 
-
-void _3DModelLoader::FreeModel(struct md2_model_t* mdl)
+void _3DModelLoader::BenchmarkInterpolation(int iterations)
 {
+  int frames = md2file.header.num_frames;
+  if (meshVerts.empty () || frames < 1 || iterations < 1)
+    return;
 
-  if (mdl->skins)
-    {
-      free (mdl->skins);
-      mdl->skins = NULL;
-    }
+  float *reference = (float *)_mm_malloc (sizeof (float) * 8 * meshVerts.size (), 16);
+  float maxDiff = 0.0f;
+  double ms[2];
 
-  if (mdl->texcoords)
+  for (int pass = 0; pass < 2; ++pass)
     {
-      free (mdl->texcoords);
-      mdl->texcoords = NULL;
+      std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now ();
+      for (int it = 0; it < iterations; ++it)
+	{
+	  int n = it % frames;
+	  float interp = (it % 7) / 7.0f;
+	  const struct md2_frame_t *a = &md2file.frames[n];
+	  const struct md2_frame_t *b = &md2file.frames[n + 1 < frames ? n + 1 : n];
+
+	  if (pass == 0)
+	    InterpolateFrames (a, b, interp, frameBuffer);
+	  else
+	    InterpolateFramesSSE (a, b, interp, frameBuffer);
+	}
+      ms[pass] = std::chrono::duration<double, std::milli> (std::chrono::steady_clock::now () - t0).count () / iterations;
     }
 
-  if (mdl->triangles)
+  /* Same frame pairs again, checking the two paths agree */
+  for (int n = 0; n < frames; ++n)
     {
-      free (mdl->triangles);
-      mdl->triangles = NULL;
+      const struct md2_frame_t *b = &md2file.frames[n + 1 < frames ? n + 1 : n];
+      InterpolateFrames (&md2file.frames[n], b, 0.37f, reference);
+      InterpolateFramesSSE (&md2file.frames[n], b, 0.37f, frameBuffer);
+      for (size_t i = 0; i < meshVerts.size () * 8; ++i)
+	maxDiff = std::max (maxDiff, fabsf (reference[i] - frameBuffer[i]));
     }
+  _mm_free (reference);
+
+  printf ("---- MD2 interpolation: %d mesh vertices, %d iterations ----\n", (int)meshVerts.size (), iterations);
+  printf ("scalar %.4f ms/frame, SSE %.4f ms/frame, speedup %.2fx, max difference %g\n",
+          ms[0], ms[1], ms[1] > 0.0 ? ms[0] / ms[1] : 0.0, maxDiff);
+}
+
+void _3DModelLoader::Animate(int start, int end, int* frame, float* interp)
+{
+
+    if ((*frame < start) || (*frame > end))
+    *frame = start;
 
-  if (mdl->glcmds)
+    if (*interp >= 1.0f)
     {
-      free (mdl->glcmds);
-      mdl->glcmds = NULL;
+      /* Move to next frame */
+      *interp = 0.0f;
+      (*frame)++;
+
+      if (*frame >= end)
+	*frame = start;
     }
 
-  if (mdl->frames)
-    {
+}
 
-      for (int i = 0; i < mdl->header.num_frames; ++i)
-	{
-	  free (mdl->frames[i].verts);
-	  mdl->frames[i].verts = NULL;
-	}
+void _3DModelLoader::initModel(const char* filename)
+{
 
-      free (mdl->frames);
-      mdl->frames = NULL;
-    }
+    /* Load MD2 model file */
+    if (!ReadMD2Model (filename, &md2file))
+    exit (EXIT_FAILURE);
+
+    loadSkins (&md2file);
+    UploadBuffers ();
+
+
+}
+
+void _3DModelLoader::Update(float deltaTime)
+{
+  if (!ownInstance)
+    ownInstance = new _md2Instance (this);
+
+  /* Actions() picks the range, the instance keeps its own clock */
+  ownInstance->setFrames (StartFrame, EndFrame);
+  ownInstance->update (deltaTime);
+}
+
+void _3DModelLoader::Draw(/**float xPos, float yPos, float zPos, float angle, float xRot, float yRot, float zRot**/)
+{
+  ///glTranslatef(xPos, yPos, zPos);
+  ///glRotatef(angle, xRot, yRot, zRot);
+
+  if (ownInstance)
+    ownInstance->draw ();
+  else
+    DrawFrame (StartFrame, 0.0f);
+}
+
+void _3DModelLoader::DrawFrame(int n, float interp)
+{
+   /* Frames resident on the GPU, else CPU interpolation; immediate mode only until the buffers are uploaded */
+   if (_gpuMD2::instance ()->canDraw (this))
+     _gpuMD2::instance ()->draw (this, n, interp);
+   else if (iboMesh)
+     RenderFrameItpWithVBO (n, interp, &md2file);
+   else
+     RenderFrameItpWithGLCmds (n, interp, &md2file);
+}
+
+/* Shared with _md2Instance::setAction, in enum order */
+const int _3DModelLoader::ActionFrames[ATTACK + 1][2] = {
+    {0, 39},    // STAND
+    {-1, -1},   // WALKLEFT
+    {-1, -1},   // WALKRIGHT
+    {40, 45},   // RUN
+    {66, 71},   // JUMP
+    {54, 65},   // PAIN
+    {46, 53}    // ATTACK
+};
+
+void _3DModelLoader::Actions()
+{
+    if (actionTrigger < STAND || actionTrigger > ATTACK || ActionFrames[actionTrigger][0] < 0) return;
+
+    StartFrame = ActionFrames[actionTrigger][0];
+    EndFrame = ActionFrames[actionTrigger][1];
+}
+
+
+void _3DModelLoader::FreeModel(struct md2_model_t* mdl)
+{
+
+  /* Everything lives in the arena from ParseMD2 */
+  if (mdl->arena) _mm_free (mdl->arena);
+
+  mdl->arena = NULL;
+  mdl->skins = NULL;
+  mdl->texcoords = NULL;
+  mdl->triangles = NULL;
+  mdl->glcmds = NULL;
+  mdl->frames = NULL;
 
 }
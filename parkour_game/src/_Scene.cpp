@@ -23,9 +23,20 @@ _Scene::_Scene()
     myCam = nullptr;
     myCol = nullptr;
     snds = nullptr;
+    assets = nullptr;
+    streamer = nullptr;
+    animations = nullptr;
+    levelBatch = nullptr;
+    culler = nullptr;
+    occlusion = nullptr;
+    pvs = nullptr;
 
     myGltfModel = nullptr;
     platform1 = nullptr;
+    animCube = nullptr;
+
+    // Left platform (moved further left and forward) - smaller footprint
+    platformWorld = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-8.0f, -3.0f, -8.0f)), glm::vec3(1.0f, 0.3f, 0.5f));
 }
 
 _Scene::~_Scene()
@@ -44,6 +55,14 @@ _Scene::~_Scene()
     delete myCam;
     delete myCol;
     delete snds;
+    delete assets;
+    delete streamer;
+    for (_animInstance *inst : animCubes) delete inst;
+    delete animations;
+    delete levelBatch;
+    delete culler;
+    delete occlusion;
+    delete pvs;
     delete myGltfModel;
     delete platform1;
 }
@@ -94,29 +113,48 @@ void _Scene::initGL()
 
     myTime->startTime = clock();
 
-    // ---- Light ----
-    myLight->setLight(GL_LIGHT0);
+    // ---- Queue file I/O and decoding on the worker pool ----
+    assets = new _assetLoader();
+
+    GLuint texID = 0, texID2 = 0, texID3 = 0;
 
     // ---- Load Textures ----
-    myTexture->loadTexture("images/tex4.jpg");
-    myPrlx->parallaxInit("images/prlx.jpg");
+    assets->loadTexture(myTexture, "images/tex4.jpg", nullptr);
+    assets->loadTexture(myPrlx->btex, "images/prlx.jpg", nullptr);
+
+    // ---- MD2 Models ----
+    assets->loadMD2(mdl3D, "models/Tekk/tris.md2");
+    assets->loadMD2(mdl3DW, "models/Tekk/weapon.md2");
+
+    // ---- Load GLTF Model ----
+    assets->loadModel(&loader, "models/monkE3.glb", &myGltfModel);
+    assets->loadModel(&loader, "models/catSkull.glb", &myGltfModel2);
+    assets->loadModel(&loader, "models/levelFloor.glb", &ground);
+    assets->loadModel(&loader, "models/levelPedestalBase.glb", &pedestalBase);
+    assets->loadModel(&loader, "models/levelPedestal.glb", &pedestal);
+    assets->loadModel(&loader, "models/ground.glb", &platform1);
+    if (animDemo) assets->loadModel(&loader, "models/cuberotate.glb", &animCube);
+
+    // ---- Load Model Texture ----
+    assets->loadTexture(testTexture, "images/test_texture.jpg", &texID);
+    assets->loadTexture(testTexture, "images/pedestal.jpg", &texID2);
+    assets->loadTexture(testTexture, "images/bone2.jpg", &texID3);
 
     // ---- Skybox ----
     mySkyBox->skyBoxInit();
-    mySkyBox->tex[0] = mySkyBox->textures->loadTexture("images/back.png");
-    mySkyBox->tex[1] = mySkyBox->textures->loadTexture("images/front.png");
-    mySkyBox->tex[2] = mySkyBox->textures->loadTexture("images/top.png");
-    mySkyBox->tex[3] = mySkyBox->textures->loadTexture("images/bottom.png");
-    mySkyBox->tex[4] = mySkyBox->textures->loadTexture("images/right.png");
-    mySkyBox->tex[5] = mySkyBox->textures->loadTexture("images/left.png");
+    assets->loadTexture(mySkyBox->textures, "images/back.png", &mySkyBox->tex[0]);
+    assets->loadTexture(mySkyBox->textures, "images/front.png", &mySkyBox->tex[1]);
+    assets->loadTexture(mySkyBox->textures, "images/top.png", &mySkyBox->tex[2]);
+    assets->loadTexture(mySkyBox->textures, "images/bottom.png", &mySkyBox->tex[3]);
+    assets->loadTexture(mySkyBox->textures, "images/right.png", &mySkyBox->tex[4]);
+    assets->loadTexture(mySkyBox->textures, "images/left.png", &mySkyBox->tex[5]);
+
+    // ---- Light ----
+    myLight->setLight(GL_LIGHT0);
 
     // ---- Sprite ----
     mySprite->spriteInit("images/eg-1.png", 6, 4);
 
-    // ---- MD2 Models ----
-    mdl3D->initModel("models/Tekk/tris.md2");
-    mdl3DW->initModel("models/Tekk/weapon.md2");
-
     // ---- Camera ----
     myCam->camInit();
 
@@ -124,27 +162,38 @@ void _Scene::initGL()
     snds->initSounds();
     snds->playSound("sounds/untitled.mp3");
 
-    // ---- Load GLTF Model ----
-    myGltfModel = loader.loadModel("models/monkE3.glb");
-    myGltfModel2 = loader.loadModel("models/catSkull.glb");
-    ground = loader.loadModel("models/levelFloor.glb");
-    pedestalBase = loader.loadModel("models/levelPedestalBase.glb");
-    pedestal = loader.loadModel("models/levelPedestal.glb");
-
-    // ---- Load Model Texture ----
-    GLuint texID = testTexture->loadTexture("images/test_texture.jpg");
-    GLuint texID2 = testTexture->loadTexture("images/pedestal.jpg");
-    GLuint texID3 = testTexture->loadTexture("images/bone2.jpg");
-
+    // ---- Wait for the uploads, everything below needs the handles ----
+    assets->finishAll();
+    assets->printTimeline();
+
+    // ---- Anything loaded after startup streams in without stalling a frame ----
+    streamer = new _textureStreamer();
+    assets->streamer = streamer;
+
+    // ---- Animated instances are posed in parallel once per frame ----
+    animations = new _animationSystem();
+    if (!_gpuSkinning::instance()->init()) std::cout << "Skinning: vertex shader path unavailable, using CPU\n";
+    if (!_gpuMD2::instance()->init()) std::cout << "MD2: vertex shader path unavailable, using CPU\n";
+    if (!_gpuInstancing::instance()->init()) std::cout << "Instancing: unavailable, repeated models draw one copy at a time\n";
+
+    // -animdemo only: spread from 10 to 76 units so the row crosses both LOD distances
+    if (animCube && !animCube->clips.empty()) {
+        animCube->textureID = texID;
+        for (int i = 0; i < 12; ++i) {
+            _animInstance *inst = new _animInstance(animCube);
+            inst->play(0, true);
+            inst->setTime(i * 0.25f);
+            inst->position = {8.0f, -2.0f, -10.0f - i * 6.0f};
+            animCubes.push_back(inst);
+            animations->add(inst);
+        }
+    }
 
     // ---- Extra platform (reuse ground model as simple platform instance)
-    platform1 = loader.loadModel("models/ground.glb");
-
     if (platform1) {
         // Use ground/test texture instead of the red texture so platform matches scene
         platform1->textureID = texID;
-        platform1->buildTriangleList();
-        platform1->uploadToGPU();
+        platform1->buildTriangleList();                     //collision only; drawn with the level batch
     }
     // ---- Bind Model Texture ----
     myGltfModel->textureID = texID;     //monke
@@ -153,6 +202,27 @@ void _Scene::initGL()
     pedestalBase->textureID = texID2;
     pedestal->textureID = texID2;
 
+    // ---- Static level geometry, one draw call per texture ----
+    glm::mat4 level = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0, -4, 0)), glm::vec3(levelScale));
+    levelBatch = new _staticBatch();
+    addLevelGeometry(levelBatch);
+    levelBatch->build();
+    levelBatch->printStats();
+
+    // ---- Precomputed visibility, baked offline with "-pvs" ----
+    pvs = new _pvs();
+    if (pvs->load("models/level.pvs", levelBatch)) pvs->printStats("level");
+    else { delete pvs; pvs = nullptr; }
+
+    culler = new _frustumCuller();
+
+    // ---- Occluders: the level pieces and the platform, rasterized on a worker every frame ----
+    occlusion = new _occlusionCuller();
+    occlusion->addOccluder(ground, glm::rotate(level, glm::radians(180.0f), glm::vec3(0, 1, 0)));
+    occlusion->addOccluder(pedestalBase, level);
+    occlusion->addOccluder(pedestal, level);
+    occlusion->addOccluder(platform1, platformWorld);
+
     if (!myGltfModel) {
         std::cerr << "GLTF: Failed to load model\n";
     }
@@ -172,6 +242,34 @@ void _Scene::initGL()
     }
 }
 
+void _Scene::addLevelGeometry(_staticBatch *batch)
+{
+    // the object order is part of the baked PVS; append new pieces at the end
+    glm::mat4 level = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0, -4, 0)), glm::vec3(levelScale));
+    batch->add(ground, glm::rotate(level, glm::radians(180.0f), glm::vec3(0, 1, 0)));
+    batch->add(pedestalBase, level);
+    batch->add(pedestal, level);
+    batch->add(platform1, platformWorld);
+}
+
+void _Scene::bakePVS()
+{
+    // CPU data only, no GL context needed
+    ground = loader.parseModel("models/levelFloor.glb");
+    pedestalBase = loader.parseModel("models/levelPedestalBase.glb");
+    pedestal = loader.parseModel("models/levelPedestal.glb");
+    platform1 = loader.parseModel("models/ground.glb");
+
+    _staticBatch batch;                                     //never built, so the triangles stay on the CPU
+    addLevelGeometry(&batch);
+    batch.printStats();
+
+    _pvs baked;
+    baked.bake(&batch, 4.0f, 256);
+    if (!baked.save("models/level.pvs")) std::cout << "PVS: could not write models/level.pvs\n";
+    baked.printStats("level");
+}
+
 
 /*
 void _Scene::updateScene()
@@ -196,6 +294,14 @@ void _Scene::updateScene()
 {
     myTime->updateDeltaTime();
 
+    assets->update();
+    streamer->update();
+
+    // poses are final when this returns, before drawScene()
+    animations->viewer = myCam->eye;
+    animations->update(myTime->deltaTime);
+    if (animDemo) animations->report();
+
     myCam->rotateXY();
 
     animTime += myTime->deltaTime;
@@ -233,8 +339,8 @@ void _Scene::updateScene()
 
         // model root transform (if present)
         glm::mat4 Mnode = glm::mat4(1.0f);
-        if (!model->nodeGlobalTransforms.empty()) {
-            Mnode = model->nodeGlobalTransforms[0];
+        if (const glm::mat4* root = model->rootTransform()) {
+            Mnode = *root;
         }
 
         glm::mat4 M = Mouter * Mnode; // final transform applied to model-space vertices
@@ -310,6 +416,45 @@ void _Scene::drawScene()
     myCam->setUpCamera();
 
 
+    // ---- Frustum culling: every instance below is tested in one pass before anything draws ----
+    culler->extract();
+    occlusion->render(culler->viewProjection());            //depth buffer fills while the frustum pass runs
+
+    //animate skull up & down
+    time = (float)glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
+    yOffset = amplitude * sin(time * speed);
+
+    glm::mat4 skullWorld[2];
+    int skullHandle[2];
+    for (int i = 0; i < 2; ++i) {
+        float side = i == 0 ? -1.0f : 1.0f;
+        glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(-4.5f * side, 7 - side * yOffset, -16));
+        m = glm::scale(m, glm::vec3(1.6f));
+        m = glm::rotate(m, glm::radians(20.0f * side), glm::vec3(0, 1, 0));
+        skullWorld[i] = glm::rotate(m, glm::radians(30.0f), glm::vec3(1, 0, 0));
+        skullHandle[i] = culler->add(myGltfModel2, skullWorld[i]);
+    }
+
+    //animated cubes: the pose is from updateScene(), visibility feeds the next update
+    std::vector<int> cubeHandle(animCubes.size());
+    for (size_t i = 0; i < animCubes.size(); ++i) {
+        _animInstance *inst = animCubes[i];
+        glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3(inst->position.x, inst->position.y, inst->position.z));
+        if (!inst->nodeGlobalTransforms.empty()) world *= inst->nodeGlobalTransforms[0];
+        cubeHandle[i] = culler->add(animCube->bounds, world);
+    }
+
+    // level objects outside the camera cell's potentially visible set are never even frustum tested
+    const unsigned char *visibleSet = pvs ? pvs->visibleSet(glm::vec3(myCam->eye.x, myCam->eye.y, myCam->eye.z)) : nullptr;
+    levelBatch->submit(culler, visibleSet);
+
+    culler->cull();
+    culler->report();
+
+    occlusion->cull(culler);
+    occlusion->report();
+
+
     // ---- Skybox ----
     glPushMatrix();
         glScalef(4.33f, 4.33f, 1.0f);
@@ -320,20 +465,7 @@ void _Scene::drawScene()
     // ---- Draw GLTF Models ----
     glPushMatrix();
 
-    // Draw extra platforms
-    if (platform1) {
-        glPushMatrix();
-            // Left platform (moved further left and forward) - smaller footprint
-            glTranslatef(-8.0f, -3.0f, -8.0f);
-            glScalef(1.0f, 0.3f, 0.5f);
-            glColor3f(1,1,1);
-            if (platform1->textureID != 0) { glEnable(GL_TEXTURE_2D); glBindTexture(GL_TEXTURE_2D, platform1->textureID); }
-            platform1->draw();
-            if (platform1->textureID != 0) glBindTexture(GL_TEXTURE_2D, 0);
-        glPopMatrix();
-    }
-
-    // (Only one platform is used now)
+    // (Only one platform is used now; it is drawn with the level batch)
 
     // Ground drawing disabled — only `platform1` should be visible as the single platform
         glTranslatef(0, 0, -20);
@@ -342,52 +474,33 @@ void _Scene::drawScene()
         //myGltfModel->draw();
     glPopMatrix();
 
-    //animate skull up & down
-    time = (float)glutGet(GLUT_ELAPSED_TIME) / 1000.0f;
-    yOffset = amplitude * sin(time * speed);
-
-    //skulls
-    glPushMatrix();
-        glTranslatef(4.5, 7 + yOffset, -16);
-        glScalef(1.6, 1.6, 1.6);
-        glColor3f(1,1,1);
-        glRotatef(-20, 0, 1, 0);
-        glRotatef(30, 1, 0, 0);
-        myGltfModel2->draw();
-    glPopMatrix();
-
-    glPushMatrix();
-        glTranslatef(-4.5, 7 - yOffset, -16);
-        glScalef(1.6, 1.6, 1.6);
-        glColor3f(1,1,1);
-        glRotatef(20, 0, 1, 0);
-        glRotatef(30, 1, 0, 0);
-        myGltfModel2->draw();
-    glPopMatrix();
+    //skulls: the visible copies in one instanced draw
+    skullMatrices.clear();
+    skullColors.clear();
+    for (int i = 0; i < 2; ++i) {
+        if (!culler->visible(skullHandle[i])) continue;
+        skullMatrices.push_back(skullWorld[i]);
+        skullColors.push_back(glm::vec4(1.0f));
+    }
+    myGltfModel2->drawInstanced(skullMatrices, skullColors);
 
+    //animated cubes; culled ones skip their next pose update
+    for (size_t i = 0; i < animCubes.size(); ++i) {
+        _animInstance *inst = animCubes[i];
+        inst->visible = culler->visible(cubeHandle[i]);
+        if (!inst->visible) continue;
 
-    //level
-    glPushMatrix();
-        glTranslatef(0, -4, 0);
-        glScalef(levelScale, levelScale, levelScale);
-        glColor3f(1,1,1);
-        glRotatef(180, 0, 1, 0);
-        ground->draw();
-    glPopMatrix();
+        glPushMatrix();
+            glTranslatef(inst->position.x, inst->position.y, inst->position.z);
+            glColor3f(1,1,1);
+            inst->draw();
+        glPopMatrix();
+    }
 
-    glPushMatrix();
-        glTranslatef(0, -4, 0);
-        glScalef(levelScale, levelScale, levelScale);
-        glColor3f(1,1,1);
-        pedestalBase->draw();
-    glPopMatrix();
 
-    glPushMatrix();
-        glTranslatef(0, -4, 0);
-        glScalef(levelScale, levelScale, levelScale);
-        glColor3f(1,1,1);
-        pedestal->draw();
-    glPopMatrix();
+    //level: ground, pedestal base, pedestal and platform, already in world space
+    glColor3f(1,1,1);
+    levelBatch->draw(culler);
 }
 
 int _Scene::winMsg(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
@@ -0,0 +1,552 @@
+#include "_animClip.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
+
+_animClip::_animClip()
+{
+    //ctor
+}
+
+_animClip::~_animClip()
+{
+    //dtor
+    if (keyTimes) _mm_free(keyTimes);
+    if (keyValues) _mm_free(keyValues);
+    if (weightValues) _mm_free(weightValues);
+    if (packedKeys) _mm_free(packedKeys);
+}
+
+bool _animClip::build(const cgltf_data *data, const cgltf_animation *anim, const std::vector<int> &morphSlot)
+{
+    if (!data || !anim) return false;
+
+    name = anim->name ? anim->name : "";
+
+    // ---- Collect usable channels, ordered by target node then path ----
+    std::vector<animTrack> found;
+    std::vector<weightTrack> foundWeights;
+    std::vector<const cgltf_animation_sampler*> samplers;
+
+    for (cgltf_size c = 0; c < anim->channels_count; ++c)
+    {
+        const cgltf_animation_channel &ch = anim->channels[c];
+        const cgltf_animation_sampler *s = ch.sampler;
+        if (!ch.target_node || !s || !s->input || !s->output || s->input->count == 0) continue;
+
+        int interp = LINEAR;
+        if (s->interpolation == cgltf_interpolation_type_step) interp = STEP;
+        else if (s->interpolation == cgltf_interpolation_type_cubic_spline) interp = CUBICSPLINE;
+
+        int node = (int)(ch.target_node - data->nodes);
+        size_t perKey = interp == CUBICSPLINE ? 3 : 1;
+
+        if (ch.target_path == cgltf_animation_path_type_weights)
+        {
+            // one scalar per morph target per key; the mesh decides where they land
+            int slot = node < (int)morphSlot.size() ? morphSlot[node] : -1;
+            int count = (int)(s->output->count / (s->input->count * perKey));
+            if (slot < 0 || count == 0) continue;
+
+            weightTrack wt = {slot, count, (count + 3) & ~3, interp, (int)s->input->count, (int)samplers.size(), 0};
+            foundWeights.push_back(wt);
+            samplers.push_back(s);
+            continue;
+        }
+
+        animTrack tr = animTrack();
+        if (ch.target_path == cgltf_animation_path_type_translation) tr.path = TRANSLATION;
+        else if (ch.target_path == cgltf_animation_path_type_rotation) tr.path = ROTATION;
+        else if (ch.target_path == cgltf_animation_path_type_scale) tr.path = SCALE;
+        else continue;
+
+        tr.interp = interp;
+        tr.node = node;
+        tr.keyCount = (int)s->input->count;
+
+        if (s->output->count < s->input->count * perKey) continue;
+
+        tr.timeOffset = (int)samplers.size();               //temporarily the sampler slot
+        tr.valueOffset = 0;
+        found.push_back(tr);
+        samplers.push_back(s);
+    }
+
+    std::stable_sort(found.begin(), found.end(), [](const animTrack &a, const animTrack &b) {
+        return a.node != b.node ? a.node < b.node : a.path < b.path;
+    });
+
+    // ---- Size the flat arrays; key times are shared per input accessor ----
+    std::map<const cgltf_accessor*, int> timeOffsets;
+    timeCount = 0;
+    valueCount = 0;
+    weightValueCount = 0;
+
+    for (const cgltf_animation_sampler *s : samplers) {
+        if (timeOffsets.find(s->input) == timeOffsets.end()) {
+            timeOffsets[s->input] = timeCount;
+            timeCount += (int)s->input->count;
+        }
+    }
+
+    for (animTrack &tr : found) {
+        tr.valueOffset = valueCount;
+        valueCount += tr.keyCount * (tr.interp == CUBICSPLINE ? 3 : 1);
+    }
+
+    for (weightTrack &wt : foundWeights) {
+        wt.valueOffset = weightValueCount;
+        weightValueCount += wt.keyCount * (wt.interp == CUBICSPLINE ? 3 : 1) * wt.stride;
+    }
+
+    if (keyTimes) _mm_free(keyTimes);
+    if (keyValues) _mm_free(keyValues);
+    if (weightValues) _mm_free(weightValues);
+    if (packedKeys) _mm_free(packedKeys);
+    packedKeys = nullptr;
+    packedCount = 0;
+    compressed = false;
+    maxError = 0.0f;
+
+    keyTimes = (float*)_mm_malloc(sizeof(float) * (timeCount ? timeCount : 1), 16);
+    keyValues = (__m128*)_mm_malloc(sizeof(__m128) * (valueCount ? valueCount : 1), 16);
+    weightValues = (float*)_mm_malloc(sizeof(float) * (weightValueCount ? weightValueCount : 4), 16);
+
+    // ---- Decode every key once ----
+    duration = 0.0f;
+    for (auto &it : timeOffsets) {
+        const cgltf_accessor *input = it.first;
+        cgltf_accessor_unpack_floats(input, keyTimes + it.second, input->count);
+        duration = std::max(duration, keyTimes[it.second + input->count - 1]);
+    }
+
+    for (animTrack &tr : found) {
+        const cgltf_animation_sampler *s = samplers[tr.timeOffset];
+        int comps = tr.path == ROTATION ? 4 : 3;
+        int values = tr.keyCount * (tr.interp == CUBICSPLINE ? 3 : 1);
+
+        for (int k = 0; k < values; ++k) {
+            float v[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            cgltf_accessor_read_float(s->output, k, v, comps);
+            keyValues[tr.valueOffset + k] = _mm_setr_ps(v[0], v[1], v[2], v[3]);
+        }
+        tr.timeOffset = timeOffsets[s->input];
+    }
+
+    for (weightTrack &wt : foundWeights) {
+        const cgltf_animation_sampler *s = samplers[wt.timeOffset];
+        int elements = wt.keyCount * (wt.interp == CUBICSPLINE ? 3 : 1);
+
+        // pad each key to a multiple of 4 so the sampler never reads across keys
+        float *dst = weightValues + wt.valueOffset;
+        for (int e = 0; e < elements; ++e) {
+            for (int k = 0; k < wt.stride; ++k) {
+                float v = 0.0f;
+                if (k < wt.count) cgltf_accessor_read_float(s->output, e * wt.count + k, &v, 1);
+                dst[e * wt.stride + k] = v;
+            }
+        }
+        wt.timeOffset = timeOffsets[s->input];
+    }
+
+    tracks.swap(found);
+    weightTracks.swap(foundWeights);
+
+    nodes.clear();
+    for (const animTrack &tr : tracks) {
+        if (nodes.empty() || nodes.back() != tr.node) nodes.push_back(tr.node);
+    }
+    return !tracks.empty() || !weightTracks.empty();
+}
+
+int _animClip::findKey(const float *times, int count, float t, int &cursor)
+{
+    if (count < 2 || t <= times[0]) { cursor = 0; return 0; }
+    if (t >= times[count - 1])      { cursor = count - 1; return count - 1; }
+
+    int c = cursor < count - 1 ? cursor : count - 2;
+
+    // usual case: still in the same interval, or moved on by one
+    if (times[c] <= t && t < times[c + 1]) return c;
+    if (c + 2 < count && times[c + 1] <= t && t < times[c + 2]) { cursor = c + 1; return cursor; }
+
+    // seek, loop or reverse playback: binary search
+    cursor = (int)(std::upper_bound(times, times + count, t) - times) - 1;
+    return cursor;
+}
+
+static inline __m128 dot4(__m128 a, __m128 b)
+{
+    // dot product broadcast to all four lanes (SSE1 only, no _mm_dp_ps)
+    __m128 m = _mm_mul_ps(a, b);
+    __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static inline __m128 normalize4(__m128 q)
+{
+    __m128 len = _mm_sqrt_ps(dot4(q, q));
+    return _mm_div_ps(q, _mm_max_ps(len, _mm_set1_ps(1e-12f)));
+}
+
+void _animClip::sample(float t, nodeTRS_t *pose, int *cursors, unsigned char *dirty) const
+{
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        const animTrack &tr = tracks[i];
+        const float *times = keyTimes + tr.timeOffset;
+        const __m128 *v = tr.packed ? nullptr : keyValues + tr.valueOffset;
+
+        int k0 = findKey(times, tr.keyCount, t, cursors[i]);
+        int k1 = k0 + 1 < tr.keyCount && t > times[0] ? k0 + 1 : k0;
+
+        float dt = times[k1] - times[k0];
+        float f = dt > 0.0f ? (t - times[k0]) / dt : 0.0f;
+
+        __m128 out;
+        if (tr.interp == STEP || k0 == k1) {
+            out = tr.packed ? unpackKey(tr, packedKeys + (tr.valueOffset + k0) * 3) : v[tr.interp == CUBICSPLINE ? k0 * 3 + 1 : k0];
+        }
+        else if (tr.interp == LINEAR) {
+            __m128 a = tr.packed ? unpackKey(tr, packedKeys + (tr.valueOffset + k0) * 3) : v[k0];
+            __m128 b = tr.packed ? unpackKey(tr, packedKeys + (tr.valueOffset + k1) * 3) : v[k1];
+
+            // rotations: shortest-arc nlerp, close to slerp at animation key spacing
+            if (tr.path == ROTATION) b = _mm_xor_ps(b, _mm_and_ps(dot4(a, b), signMask));
+
+            out = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(f)));
+            if (tr.path == ROTATION) out = normalize4(out);
+        }
+        else {
+            // ---- Cubic Hermite: keys are stored as [in-tangent, value, out-tangent] ----
+            __m128 p0 = v[k0 * 3 + 1];
+            __m128 m0 = _mm_mul_ps(v[k0 * 3 + 2], _mm_set1_ps(dt));
+            __m128 p1 = v[k1 * 3 + 1];
+            __m128 m1 = _mm_mul_ps(v[k1 * 3 + 0], _mm_set1_ps(dt));
+
+            float f2 = f * f, f3 = f2 * f;
+            out = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(2.0f * f3 - 3.0f * f2 + 1.0f)),
+                                        _mm_mul_ps(m0, _mm_set1_ps(f3 - 2.0f * f2 + f))),
+                             _mm_add_ps(_mm_mul_ps(p1, _mm_set1_ps(-2.0f * f3 + 3.0f * f2)),
+                                        _mm_mul_ps(m1, _mm_set1_ps(f3 - f2))));
+            if (tr.path == ROTATION) out = normalize4(out);
+        }
+
+        nodeTRS_t &dst = pose[tr.node];
+        float *slot = tr.path == TRANSLATION ? dst.translation : tr.path == ROTATION ? dst.rotation : dst.scale;
+
+        // only flag the node when the value really moved (clamped or held keys stay clean)
+        if (dirty && _mm_movemask_ps(_mm_cmpneq_ps(_mm_loadu_ps(slot), out))) dirty[tr.node] = 1;
+        _mm_storeu_ps(slot, out);
+    }
+}
+
+// ---- Key compression ----
+
+static const float halfSqrt2 = 0.70710678f;                 //smallest-three components lie in [-1/sqrt2, 1/sqrt2]
+
+void _animClip::packRotation(const float *q, unsigned short *out)
+{
+    float len = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    if (len <= 0.0f) len = 1.0f;
+
+    int largest = 0;
+    for (int i = 1; i < 4; ++i) {
+        if (fabsf(q[i]) > fabsf(q[largest])) largest = i;
+    }
+
+    // drop the largest component and make it positive; q and -q are the same rotation
+    float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+    unsigned short v[3];
+    for (int i = 0, j = 0; i < 4; ++i) {
+        if (i == largest) continue;
+        float c = std::min(std::max(q[i] * sign / len, -halfSqrt2), halfSqrt2);
+        v[j++] = (unsigned short)lrintf((c + halfSqrt2) / (2.0f * halfSqrt2) * 32767.0f);
+    }
+
+    // 2-bit index in the top bits of the first two shorts, 15 bits per component
+    out[0] = (unsigned short)(v[0] | ((largest >> 1) << 15));
+    out[1] = (unsigned short)(v[1] | ((largest & 1) << 15));
+    out[2] = v[2];
+}
+
+__m128 _animClip::unpackRotation(const unsigned short *p)
+{
+    int largest = ((p[0] >> 15) << 1) | (p[1] >> 15);
+
+    __m128 q = _mm_setr_ps((float)(p[0] & 0x7fff), (float)(p[1] & 0x7fff), (float)p[2], 0.0f);
+    q = _mm_sub_ps(_mm_mul_ps(q, _mm_set1_ps(2.0f * halfSqrt2 / 32767.0f)), _mm_set1_ps(halfSqrt2));
+
+    float c[4];
+    _mm_storeu_ps(c, q);
+    float w = sqrtf(std::max(0.0f, 1.0f - c[0] * c[0] - c[1] * c[1] - c[2] * c[2]));
+
+    switch (largest) {
+        case 0:  return _mm_setr_ps(w, c[0], c[1], c[2]);
+        case 1:  return _mm_setr_ps(c[0], w, c[1], c[2]);
+        case 2:  return _mm_setr_ps(c[0], c[1], w, c[2]);
+        default: return _mm_setr_ps(c[0], c[1], c[2], w);
+    }
+}
+
+__m128 _animClip::unpackKey(const animTrack &tr, const unsigned short *p)
+{
+    if (tr.path == ROTATION) return unpackRotation(p);
+
+    __m128 q = _mm_setr_ps((float)p[0], (float)p[1], (float)p[2], 0.0f);
+    return _mm_add_ps(_mm_loadu_ps(tr.rangeMin), _mm_mul_ps(q, _mm_loadu_ps(tr.rangeScale)));
+}
+
+static inline __m128 interpolateKey(__m128 a, __m128 b, float f, bool rotation)
+{
+    if (!rotation) return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(f)));
+
+    b = _mm_xor_ps(b, _mm_and_ps(dot4(a, b), _mm_set1_ps(-0.0f)));
+    return normalize4(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(f))));
+}
+
+static inline float keyError(__m128 a, __m128 b, bool rotation)
+{
+    // rotations compare on the same hemisphere
+    if (rotation) b = _mm_xor_ps(b, _mm_and_ps(dot4(a, b), _mm_set1_ps(-0.0f)));
+
+    float d[4];
+    _mm_storeu_ps(d, _mm_andnot_ps(_mm_set1_ps(-0.0f), _mm_sub_ps(a, b)));
+    return std::max(std::max(d[0], d[1]), std::max(d[2], d[3]));
+}
+
+bool _animClip::compress(float tolerance)
+{
+    if (compressed || tracks.empty()) return false;
+
+    std::vector<animTrack> out = tracks;
+    std::vector<float> times;
+    std::vector<float> rawValues;                           //CUBICSPLINE tracks keep their tangents as floats
+    std::vector<unsigned short> packed;
+    float worst = 0.0f;
+
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        const animTrack &src = tracks[i];
+        animTrack &tr = out[i];
+        const float *T = keyTimes + src.timeOffset;
+        const __m128 *orig = keyValues + src.valueOffset;
+        int n = src.keyCount;
+        bool rotation = src.path == ROTATION;
+
+        tr.timeOffset = (int)times.size();
+
+        if (src.interp == CUBICSPLINE) {
+            times.insert(times.end(), T, T + n);
+            tr.valueOffset = (int)rawValues.size() / 4;
+            rawValues.insert(rawValues.end(), (const float*)orig, (const float*)(orig + n * 3));
+            continue;
+        }
+
+        // ---- Quantise every key: per-track range for T/S, smallest-three for rotations ----
+        if (!rotation) {
+            float lo[4], hi[4];
+            _mm_storeu_ps(lo, orig[0]);
+            _mm_storeu_ps(hi, orig[0]);
+            for (int k = 1; k < n; ++k) {
+                float v[4];
+                _mm_storeu_ps(v, orig[k]);
+                for (int c = 0; c < 3; ++c) { lo[c] = std::min(lo[c], v[c]); hi[c] = std::max(hi[c], v[c]); }
+            }
+            for (int c = 0; c < 4; ++c) {
+                tr.rangeMin[c] = c < 3 ? lo[c] : 0.0f;
+                tr.rangeScale[c] = c < 3 ? (hi[c] - lo[c]) / 65535.0f : 0.0f;
+            }
+        }
+
+        std::vector<unsigned short> q(n * 3);
+        for (int k = 0; k < n; ++k) {
+            float v[4];
+            _mm_storeu_ps(v, orig[k]);
+            if (rotation) {
+                packRotation(v, &q[k * 3]);
+                continue;
+            }
+            for (int c = 0; c < 3; ++c) {
+                float x = tr.rangeScale[c] > 0.0f ? (v[c] - tr.rangeMin[c]) / tr.rangeScale[c] : 0.0f;
+                q[k * 3 + c] = (unsigned short)std::min(std::max(lrintf(x), 0L), 65535L);
+            }
+        }
+
+        // decode through the runtime path so the error below is what sample() will produce
+        tr.packed = true;
+        std::vector<float> decoded(n * 4);
+        for (int k = 0; k < n; ++k) _mm_storeu_ps(&decoded[k * 4], unpackKey(tr, &q[k * 3]));
+        auto dec = [&](int k) { return _mm_loadu_ps(&decoded[k * 4]); };
+
+        // ---- Error of replacing keys a..b with their end points, at every key and midpoint between ----
+        auto segmentError = [&](int a, int b) {
+            float err = std::max(keyError(orig[a], dec(a), rotation), keyError(orig[b], dec(b), rotation));
+            for (int k = a + 1; k <= b; ++k) {
+                float span = T[b] - T[a];
+                float tm = 0.5f * (T[k - 1] + T[k]);
+
+                __m128 want = src.interp == STEP ? orig[k - 1] : interpolateKey(orig[k - 1], orig[k], 0.5f, rotation);
+                __m128 got = src.interp == STEP ? dec(a) : interpolateKey(dec(a), dec(b), span > 0.0f ? (tm - T[a]) / span : 0.0f, rotation);
+                err = std::max(err, keyError(want, got, rotation));
+
+                if (k == b) break;
+                got = src.interp == STEP ? dec(a) : interpolateKey(dec(a), dec(b), span > 0.0f ? (T[k] - T[a]) / span : 0.0f, rotation);
+                err = std::max(err, keyError(orig[k], got, rotation));
+            }
+            return err;
+        };
+
+        // ---- Greedy reduction: stretch each segment until it no longer fits ----
+        std::vector<int> keep(1, 0);
+        for (int j = 2; j < n; ++j) {
+            if (segmentError(keep.back(), j) > tolerance) keep.push_back(j - 1);
+        }
+        if (n > 1) keep.push_back(n - 1);
+
+        // a track that never leaves tolerance of its first key needs only that key
+        bool constant = true;
+        for (int k = 1; k < n && constant; ++k) constant = keyError(orig[k], dec(0), rotation) <= tolerance;
+        if (constant) keep.resize(1);
+
+        for (size_t k = 0; k < keep.size(); ++k) {
+            times.push_back(T[keep[k]]);
+            packed.insert(packed.end(), &q[keep[k] * 3], &q[keep[k] * 3] + 3);
+            worst = std::max(worst, k + 1 < keep.size() ? segmentError(keep[k], keep[k + 1]) : keyError(orig[keep[k]], dec(keep[k]), rotation));
+        }
+        for (int k = 1; constant && k < n; ++k) worst = std::max(worst, keyError(orig[k], dec(0), rotation));
+
+        tr.keyCount = (int)keep.size();
+        tr.valueOffset = (int)(packed.size() / 3) - tr.keyCount;
+    }
+
+    // ---- Swap in the new arrays; weight tracks keep their own times ----
+    for (weightTrack &wt : weightTracks) {
+        const float *T = keyTimes + wt.timeOffset;
+        wt.timeOffset = (int)times.size();
+        times.insert(times.end(), T, T + wt.keyCount);
+    }
+
+    float *newTimes = (float*)_mm_malloc(sizeof(float) * (times.empty() ? 1 : times.size()), 16);
+    __m128 *newValues = (__m128*)_mm_malloc(sizeof(float) * (rawValues.empty() ? 4 : rawValues.size()), 16);
+    unsigned short *newPacked = (unsigned short*)_mm_malloc(sizeof(unsigned short) * (packed.empty() ? 3 : packed.size()), 16);
+    std::copy(times.begin(), times.end(), newTimes);
+    std::copy(rawValues.begin(), rawValues.end(), (float*)newValues);
+    std::copy(packed.begin(), packed.end(), newPacked);
+
+    _mm_free(keyTimes);
+    _mm_free(keyValues);
+    if (packedKeys) _mm_free(packedKeys);
+    keyTimes = newTimes;
+    keyValues = newValues;
+    packedKeys = newPacked;
+
+    timeCount = (int)times.size();
+    valueCount = (int)rawValues.size() / 4;
+    packedCount = (int)(packed.size() / 3);
+    tracks.swap(out);
+
+    maxError = worst;
+    compressed = true;
+    return true;
+}
+
+size_t _animClip::byteSize() const
+{
+    return sizeof(float) * timeCount + sizeof(__m128) * valueCount + sizeof(unsigned short) * 3 * packedCount
+         + sizeof(float) * weightValueCount
+         + sizeof(animTrack) * tracks.size() + sizeof(weightTrack) * weightTracks.size();
+}
+
+int _animClip::keyCount() const
+{
+    int keys = 0;
+    for (const animTrack &tr : tracks) keys += tr.keyCount;
+    return keys;
+}
+
+bool _animClip::sampleWeights(float t, float *weights, int *cursors) const
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < weightTracks.size(); ++i)
+    {
+        const weightTrack &wt = weightTracks[i];
+        const float *times = keyTimes + wt.timeOffset;
+        const float *v = weightValues + wt.valueOffset;
+
+        int k0 = findKey(times, wt.keyCount, t, cursors[tracks.size() + i]);
+        int k1 = k0 + 1 < wt.keyCount && t > times[0] ? k0 + 1 : k0;
+
+        float dt = times[k1] - times[k0];
+        float f = dt > 0.0f ? (t - times[k0]) / dt : 0.0f;
+        float f2 = f * f, f3 = f2 * f;
+
+        // ---- Four targets per step; the padded lanes are never written out ----
+        for (int c = 0; c < wt.count; c += 4)
+        {
+            __m128 out;
+            if (wt.interp == STEP || k0 == k1) {
+                out = _mm_load_ps(v + (wt.interp == CUBICSPLINE ? k0 * 3 + 1 : k0) * wt.stride + c);
+            }
+            else if (wt.interp == LINEAR) {
+                __m128 a = _mm_load_ps(v + k0 * wt.stride + c);
+                __m128 b = _mm_load_ps(v + k1 * wt.stride + c);
+                out = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(f)));
+            }
+            else {
+                __m128 p0 = _mm_load_ps(v + (k0 * 3 + 1) * wt.stride + c);
+                __m128 m0 = _mm_mul_ps(_mm_load_ps(v + (k0 * 3 + 2) * wt.stride + c), _mm_set1_ps(dt));
+                __m128 p1 = _mm_load_ps(v + (k1 * 3 + 1) * wt.stride + c);
+                __m128 m1 = _mm_mul_ps(_mm_load_ps(v + (k1 * 3 + 0) * wt.stride + c), _mm_set1_ps(dt));
+
+                out = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(2.0f * f3 - 3.0f * f2 + 1.0f)),
+                                            _mm_mul_ps(m0, _mm_set1_ps(f3 - 2.0f * f2 + f))),
+                                 _mm_add_ps(_mm_mul_ps(p1, _mm_set1_ps(-2.0f * f3 + 3.0f * f2)),
+                                            _mm_mul_ps(m1, _mm_set1_ps(f3 - f2))));
+            }
+
+            float lanes[4];
+            _mm_storeu_ps(lanes, out);
+
+            float *dst = weights + wt.slot + c;
+            for (int k = 0; k < 4 && c + k < wt.count; ++k) {
+                if (dst[k] != lanes[k]) changed = true;
+                dst[k] = lanes[k];
+            }
+        }
+    }
+    return changed;
+}
+
+void _animClip::blendPose(const nodeTRS_t *from, const nodeTRS_t *to, float w, const std::vector<int> &nodes, nodeTRS_t *out, unsigned char *dirty)
+{
+    const __m128 weight = _mm_set1_ps(w);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (int i : nodes)
+    {
+        __m128 t0 = _mm_loadu_ps(from[i].translation), t1 = _mm_loadu_ps(to[i].translation);
+        __m128 r0 = _mm_loadu_ps(from[i].rotation),    r1 = _mm_loadu_ps(to[i].rotation);
+        __m128 s0 = _mm_loadu_ps(from[i].scale),       s1 = _mm_loadu_ps(to[i].scale);
+
+        r1 = _mm_xor_ps(r1, _mm_and_ps(dot4(r0, r1), signMask));
+
+        __m128 t = _mm_add_ps(t0, _mm_mul_ps(_mm_sub_ps(t1, t0), weight));
+        __m128 r = normalize4(_mm_add_ps(r0, _mm_mul_ps(_mm_sub_ps(r1, r0), weight)));
+        __m128 s = _mm_add_ps(s0, _mm_mul_ps(_mm_sub_ps(s1, s0), weight));
+
+        if (dirty) {
+            __m128 changed = _mm_or_ps(_mm_cmpneq_ps(t, _mm_loadu_ps(out[i].translation)),
+                             _mm_or_ps(_mm_cmpneq_ps(r, _mm_loadu_ps(out[i].rotation)),
+                                       _mm_cmpneq_ps(s, _mm_loadu_ps(out[i].scale))));
+            if (_mm_movemask_ps(changed)) dirty[i] = 1;
+        }
+
+        _mm_storeu_ps(out[i].translation, t);
+        _mm_storeu_ps(out[i].rotation, r);
+        _mm_storeu_ps(out[i].scale, s);
+    }
+}
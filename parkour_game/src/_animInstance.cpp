@@ -0,0 +1,348 @@
+#include "_animInstance.h"
+#include "_gpuSkinning.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+_animInstance::_animInstance(GltfModel *m)
+{
+    //ctor
+    model = m;
+
+    // everything is sized once here; updates never allocate
+    size_t n = model->restPose.size();
+    pose = model->restPose;
+    nodeLocalTransforms.assign(n, glm::mat4(1.0f));
+    nodeGlobalTransforms.assign(n, glm::mat4(1.0f));
+    nodeDirty.assign(n, 1);
+    nodeMoved.assign(n, 0);
+
+    if (model->isSkinned()) jointMatrices.assign(model->skinJoints.size(), glm::mat4(1.0f));
+    morphWeights = model->morphWeights;
+
+    play(0, true);
+}
+
+_animInstance::~_animInstance()
+{
+    //dtor
+    if (skinnedVertices) _mm_free(skinnedVertices);
+    if (morphedVertices) _mm_free(morphedVertices);
+    if (skinVBO) glDeleteBuffers(1, &skinVBO);
+}
+
+void _animInstance::play(int index, bool looping)
+{
+    clip = index;
+    loop = looping;
+    time = 0.0f;
+
+    int tracks = (clip >= 0 && clip < (int)model->clips.size()) ? model->clips[clip]->trackCount() : 0;
+    cursors.assign(tracks, 0);
+}
+
+void _animInstance::setTime(float t)
+{
+    time = t;
+}
+
+const _animClip *_animInstance::currentClip() const
+{
+    if (clip < 0 || clip >= (int)model->clips.size() || pose.empty()) return nullptr;
+    return model->clips[clip];
+}
+
+float _animInstance::wrapTime(float t) const
+{
+    const _animClip *c = currentClip();
+    if (!c || !loop || c->duration <= 0.0f) return t;
+
+    t = fmodf(t, c->duration);
+    return t < 0.0f ? t + c->duration : t;
+}
+
+void _animInstance::update(float dt)
+{
+    const _animClip *c = currentClip();
+    if (!c) return;
+
+    time = wrapTime(time + dt * speed);
+
+    c->sample(time, pose.data(), cursors.data(), nodeDirty.data());
+    if (c->hasWeights()) c->sampleWeights(time, morphWeights.data(), cursors.data());
+    computeGlobalTransforms();
+
+    lodRate = 1;                                            //the next drop to a reduced rate starts a fresh cycle
+    lodPhase = 0;
+    stale = false;
+}
+
+bool _animInstance::updateLOD(float dt, int rate)
+{
+    const _animClip *c = currentClip();
+    if (!c) return false;
+
+    // full rate, or catching up after being culled
+    if (rate <= 1 || stale) {
+        update(dt);
+        return true;
+    }
+
+    time = wrapTime(time + dt * speed);
+
+    bool sampled = false;
+    if (lodPhase == 0 || rate != lodRate)
+    {
+        // a shorter first cycle after a rate change keeps a crowd from sampling on the same frame
+        int frames = rate != lodRate ? 1 + lodSlot % rate : rate;
+
+        // ---- Start a cycle: blend from what is shown now to the pose frames-1 ahead ----
+        if (poseTo.empty()) poseTo = pose;                  //only instances that ever drop rate pay for these
+        poseFrom = pose;
+
+        float ahead = wrapTime(time + dt * speed * (frames - 1));
+        c->sample(ahead, poseTo.data(), cursors.data(), nullptr);
+        if (c->hasWeights()) c->sampleWeights(ahead, morphWeights.data(), cursors.data());  //weights step at the reduced rate, to the pose they match
+
+        lodRate = rate;
+        lodFrames = frames;
+        lodPhase = 0;
+        sampled = true;
+    }
+
+    lodPhase++;
+    _animClip::blendPose(poseFrom.data(), poseTo.data(), (float)lodPhase / lodFrames, c->targetNodes(), pose.data(), nodeDirty.data());
+    if (lodPhase >= lodFrames) lodPhase = 0;
+
+    computeGlobalTransforms();
+    return sampled;
+}
+
+void _animInstance::skip(float dt)
+{
+    time = wrapTime(time + dt * speed);
+    stale = true;
+}
+
+static inline void mulMat4(const float *a, const float *b, float *out)
+{
+    // column-major like glm: out.col[j] = a * b.col[j]
+    __m128 c0 = _mm_loadu_ps(a + 0);
+    __m128 c1 = _mm_loadu_ps(a + 4);
+    __m128 c2 = _mm_loadu_ps(a + 8);
+    __m128 c3 = _mm_loadu_ps(a + 12);
+
+    for (int j = 0; j < 4; ++j) {
+        const float *bj = b + j * 4;
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(bj[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(bj[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(bj[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(bj[3])));
+        _mm_storeu_ps(out + j * 4, r);
+    }
+}
+
+void _animInstance::computeGlobalTransforms()
+{
+    const std::vector<int> &order = model->hierNode;
+    const std::vector<int> &parents = model->hierParent;
+
+    // a node is recomputed only if it or an ancestor changed
+    for (size_t k = 0; k < order.size(); ++k)
+    {
+        int i = order[k];
+        int parent = parents[k];
+
+        bool moved = nodeDirty[i] || (parent >= 0 && nodeMoved[parent]);
+        nodeMoved[i] = moved;
+        if (!moved) continue;
+
+        if (nodeDirty[i]) {
+            nodeLocalTransforms[i] = model->computeLocalMatrix(i, pose[i]);
+            nodeDirty[i] = 0;
+        }
+
+        if (parent < 0) nodeGlobalTransforms[i] = nodeLocalTransforms[i];
+        else mulMat4(glm::value_ptr(nodeGlobalTransforms[parent]), glm::value_ptr(nodeLocalTransforms[i]),
+                     glm::value_ptr(nodeGlobalTransforms[i]));
+    }
+}
+
+void _animInstance::buildJointMatrices()
+{
+    for (size_t j = 0; j < jointMatrices.size(); ++j) {
+        mulMat4(glm::value_ptr(nodeGlobalTransforms[model->skinJoints[j]]), glm::value_ptr(model->inverseBindMatrices[j]),
+                glm::value_ptr(jointMatrices[j]));
+    }
+}
+
+void _animInstance::allocateSkinBuffer()
+{
+    if (!skinnedVertices) skinnedVertices = (float*)_mm_malloc(sizeof(float) * 8 * vertexCount(), 16);
+}
+
+bool _animInstance::prepareMorph()
+{
+    if (!model->hasMorphs()) return false;
+
+    if (!morphedVertices) {
+        morphedVertices = (float*)_mm_malloc(sizeof(float) * 8 * vertexCount(), 16);
+        blendedWeights.clear();
+    }
+    if (blendedWeights == morphWeights) return false;
+
+    blendedWeights = morphWeights;                          //same size after the first copy, no allocation
+    return true;
+}
+
+// out[v * 8 + 0..2] += weight * (x, y, z)[v] for n vertices; four per step, transposed from
+// the three delta streams into the interleaved layout
+static inline void addDeltas(float *out, const float *x, const float *y, const float *z, int n, __m128 weight)
+{
+    int v = 0;
+    for (; v + 4 <= n; v += 4, out += 32) {
+        __m128 r0 = _mm_mul_ps(_mm_loadu_ps(x + v), weight);
+        __m128 r1 = _mm_mul_ps(_mm_loadu_ps(y + v), weight);
+        __m128 r2 = _mm_mul_ps(_mm_loadu_ps(z + v), weight);
+        __m128 r3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        _mm_store_ps(out, _mm_add_ps(_mm_load_ps(out), r0));
+        _mm_store_ps(out + 8, _mm_add_ps(_mm_load_ps(out + 8), r1));
+        _mm_store_ps(out + 16, _mm_add_ps(_mm_load_ps(out + 16), r2));
+        _mm_store_ps(out + 24, _mm_add_ps(_mm_load_ps(out + 24), r3));
+    }
+    for (; v < n; ++v, out += 8) {
+        _mm_store_ps(out, _mm_add_ps(_mm_load_ps(out), _mm_mul_ps(_mm_setr_ps(x[v], y[v], z[v], 0.0f), weight)));
+    }
+}
+
+void _animInstance::morphRange(int first, int count)
+{
+    const float *pos = model->vertices.data();
+    const float *nrm = model->normals.size() == model->vertices.size() ? model->normals.data() : nullptr;
+    int last = first + count;
+
+    // ---- Start from the bind pose ----
+    for (int v = first; v < last; ++v) {
+        const float *p = pos + v * 3;
+        _mm_store_ps(morphedVertices + v * 8, _mm_setr_ps(p[0], p[1], p[2], 1.0f));
+        _mm_store_ps(morphedVertices + v * 8 + 4, nrm ? _mm_setr_ps(nrm[v * 3], nrm[v * 3 + 1], nrm[v * 3 + 2], 0.0f) : _mm_setzero_ps());
+    }
+
+    // ---- Add each active target over the part of its span inside this range ----
+    for (const GltfModel::MorphTarget &t : model->morphTargets)
+    {
+        float w = blendedWeights[t.weight];
+        if (w == 0.0f) continue;
+
+        int lo = std::max(first, t.firstVertex);
+        int hi = std::min(last, t.firstVertex + t.vertexCount);
+        if (lo >= hi) continue;
+
+        __m128 weight = _mm_set1_ps(w);
+        float *out = morphedVertices + lo * 8;
+
+        int skip = lo - t.firstVertex;
+        addDeltas(out, t.dx.data() + skip, t.dy.data() + skip, t.dz.data() + skip, hi - lo, weight);
+
+        // normals are renormalised by skinning, or by GL_NORMALIZE on the rigid path
+        if (!nrm || t.nx.empty()) continue;
+        addDeltas(out + 4, t.nx.data() + skip, t.ny.data() + skip, t.nz.data() + skip, hi - lo, weight);
+    }
+}
+
+void _animInstance::skinRange(int first, int count)
+{
+    // morphed models skin the blended vertices instead of the bind pose
+    const float *pos = morphedVertices ? morphedVertices : model->vertices.data();
+    const float *nrm = morphedVertices ? morphedVertices + 4
+                     : model->normals.size() == model->vertices.size() ? model->normals.data() : nullptr;
+    int stride = morphedVertices ? 8 : 3;
+    const unsigned short *jnt = model->joints.data();
+    const float *wgt = model->weights.data();
+    const float *palette = glm::value_ptr(jointMatrices[0]);
+
+    for (int v = first; v < first + count; ++v)
+    {
+        // ---- Blend the four joint matrices, one column at a time ----
+        const unsigned short *j = jnt + v * 4;
+        const float *m0 = palette + j[0] * 16;
+        const float *m1 = palette + j[1] * 16;
+        const float *m2 = palette + j[2] * 16;
+        const float *m3 = palette + j[3] * 16;
+
+        __m128 w0 = _mm_set1_ps(wgt[v * 4 + 0]);
+        __m128 w1 = _mm_set1_ps(wgt[v * 4 + 1]);
+        __m128 w2 = _mm_set1_ps(wgt[v * 4 + 2]);
+        __m128 w3 = _mm_set1_ps(wgt[v * 4 + 3]);
+
+        __m128 col[4];
+        for (int k = 0; k < 4; ++k) {
+            col[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m0 + k * 4), w0), _mm_mul_ps(_mm_loadu_ps(m1 + k * 4), w1)),
+                                _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(m2 + k * 4), w2), _mm_mul_ps(_mm_loadu_ps(m3 + k * 4), w3)));
+        }
+
+        // ---- Position (w = 1) and normal (w = 0) ----
+        const float *p = pos + v * stride;
+        __m128 outP = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col[0], _mm_set1_ps(p[0])), _mm_mul_ps(col[1], _mm_set1_ps(p[1]))),
+                                 _mm_add_ps(_mm_mul_ps(col[2], _mm_set1_ps(p[2])), col[3]));
+
+        __m128 outN = _mm_setzero_ps();
+        if (nrm) {
+            const float *n = nrm + v * stride;
+            outN = _mm_add_ps(_mm_add_ps(_mm_mul_ps(col[0], _mm_set1_ps(n[0])), _mm_mul_ps(col[1], _mm_set1_ps(n[1]))),
+                              _mm_mul_ps(col[2], _mm_set1_ps(n[2])));
+
+            __m128 m = _mm_mul_ps(outN, outN);
+            __m128 s = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+            s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+            outN = _mm_div_ps(outN, _mm_max_ps(_mm_sqrt_ps(s), _mm_set1_ps(1e-12f)));
+        }
+
+        _mm_store_ps(skinnedVertices + v * 8, outP);
+        _mm_store_ps(skinnedVertices + v * 8 + 4, outN);
+    }
+}
+
+void _animInstance::draw()
+{
+    if (_gpuSkinning::instance()->canSkin(model)) {
+        // bind pose stays on the GPU, only the palette is uploaded
+        _gpuSkinning::instance()->draw(model, jointMatrices);
+        return;
+    }
+
+    const float *streamed = skinnedVertices ? skinnedVertices : morphedVertices;
+    if (streamed && !skinVBO) glGenBuffers(1, &skinVBO);
+    if (streamed && skinChanged) {
+        // ---- Stream the CPU result, skinned or only morphed ----
+        size_t size = sizeof(float) * 8 * vertexCount();
+        glBindBuffer(GL_ARRAY_BUFFER, skinVBO);
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);     //orphan last frame's storage
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, streamed);
+        skinChanged = false;
+    }
+
+    if (skinnedVertices) {
+        model->drawGeometry(skinVBO);                       //already in model space
+        return;
+    }
+
+    glPushMatrix();
+        if (!nodeGlobalTransforms.empty()) glMultMatrixf(glm::value_ptr(nodeGlobalTransforms[0]));
+        model->drawGeometry(streamed ? skinVBO : 0);
+    glPopMatrix();
+}
+
+size_t _animInstance::poseBytes() const
+{
+    return pose.size() * sizeof(nodeTRS_t)
+         + jointMatrices.size() * sizeof(glm::mat4)
+         + (skinnedVertices ? sizeof(float) * 8 * vertexCount() : 0)
+         + (morphedVertices ? sizeof(float) * 8 * vertexCount() : 0)
+         + (morphWeights.size() + blendedWeights.size()) * sizeof(float)
+         + (poseFrom.size() + poseTo.size()) * sizeof(nodeTRS_t)
+         + (nodeLocalTransforms.size() + nodeGlobalTransforms.size()) * sizeof(glm::mat4)
+         + cursors.size() * sizeof(int)
+         + nodeDirty.size() + nodeMoved.size();
+}
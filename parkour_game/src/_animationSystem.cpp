@@ -0,0 +1,238 @@
+#include "_animationSystem.h"
+#include "_gpuSkinning.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+_animationSystem::_animationSystem(int numThreads)
+{
+    //ctor
+    if (numThreads <= 0) numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads > 1) pool = new _threadPool(numThreads - 1);   //the caller is the last thread
+
+    nextChunk = 0;
+    sampled = blended = culled = 0;
+}
+
+_animationSystem::~_animationSystem()
+{
+    //dtor
+    delete pool;
+}
+
+void _animationSystem::add(_animInstance *inst)
+{
+    if (!inst) return;
+
+    inst->lodSlot = (int)instances.size();
+    instances.push_back(inst);
+}
+
+void _animationSystem::remove(_animInstance *inst)
+{
+    instances.erase(std::remove(instances.begin(), instances.end(), inst), instances.end());
+}
+
+void _animationSystem::update(float dt)
+{
+    sampledCount = blendedCount = culledCount = 0;
+    skinnedVerts = morphedVerts = 0;
+    skinMs = 0.0;
+    if (instances.empty()) return;
+
+    // ---- Pose every instance ----
+    sampled = blended = culled = 0;
+    int chunks = ((int)instances.size() + chunkSize - 1) / chunkSize;
+    runParallel(chunks, [this, dt](int c) { poseChunk(c, dt); });
+
+    sampledCount = sampled;
+    blendedCount = blended;
+    culledCount = culled;
+
+    reportTime += dt;
+    reportFrames++;
+    reportSampled += sampledCount;
+    reportBlended += blendedCount;
+    reportCulled += culledCount;
+
+    // ---- Then morph and skin the visible ones; every result is final before anything draws ----
+    deformAll();
+}
+
+void _animationSystem::runParallel(int jobs, const std::function<void(int)> &work)
+{
+    if (jobs <= 0) return;
+
+    nextChunk = 0;
+    auto drain = [this, jobs, &work] {
+        for (int c = nextChunk.fetch_add(1); c < jobs; c = nextChunk.fetch_add(1)) work(c);
+    };
+
+    // ---- Fan out: one job per helper thread, each pulls work until none is left ----
+    int helpers = pool ? std::min(pool->threadCount(), jobs - 1) : 0;
+    for (int i = 0; i < helpers; ++i) pool->submit(drain);
+
+    drain();
+
+    // ---- Barrier ----
+    if (helpers > 0) pool->waitAll();
+}
+
+void _animationSystem::poseChunk(int c, float dt)
+{
+    int count = (int)instances.size();
+    int first = c * chunkSize;
+    int last = std::min(first + chunkSize, count);
+
+    float near2 = lodDistance[0] * lodDistance[0];
+    float far2 = lodDistance[1] * lodDistance[1];
+    int s = 0, b = 0, k = 0;                                //local counts, one atomic add per chunk
+
+    // neighbouring instances usually share a model, so its clip data stays in cache
+    for (int i = first; i < last; ++i)
+    {
+        _animInstance *inst = instances[i];
+        if (!inst->visible) {
+            inst->skip(dt);
+            k++;
+            continue;
+        }
+
+        float dx = inst->position.x - viewer.x;
+        float dy = inst->position.y - viewer.y;
+        float dz = inst->position.z - viewer.z;
+        float d2 = dx * dx + dy * dy + dz * dz;
+
+        int rate = d2 > far2 ? 4 : d2 > near2 ? 2 : 1;
+        if (inst->updateLOD(dt, rate)) s++;
+        else b++;
+    }
+
+    sampled += s;
+    blended += b;
+    culled += k;
+}
+
+void _animationSystem::deformAll()
+{
+    skinJobs.clear();
+    for (_animInstance *inst : instances)
+    {
+        if (!inst->visible) continue;
+
+        bool morph = inst->prepareMorph();                  //unchanged weights keep last frame's blend
+        bool skin = false;
+
+        if (inst->model->isSkinned()) {
+            inst->buildJointMatrices();
+            if (!_gpuSkinning::instance()->canSkin(inst->model)) {     //otherwise the palette is all the shader needs
+                inst->allocateSkinBuffer();
+                skin = true;
+            }
+        }
+        if (!morph && !skin) continue;
+
+        int verts = inst->vertexCount();
+        for (int first = 0; first < verts; first += skinChunk) {
+            skinJob job = {inst, first, std::min(skinChunk, verts - first), morph, skin};
+            skinJobs.push_back(job);
+        }
+        inst->skinChanged = true;
+        if (skin) skinnedVerts += verts;
+        if (morph) morphedVerts += verts;
+    }
+    if (skinJobs.empty()) return;
+
+    auto t0 = std::chrono::steady_clock::now();
+    runParallel((int)skinJobs.size(), [this](int j) {
+        const skinJob &job = skinJobs[j];
+        if (job.morph) job.inst->morphRange(job.first, job.count);
+        if (job.skin) job.inst->skinRange(job.first, job.count);
+    });
+    auto t1 = std::chrono::steady_clock::now();
+
+    skinMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+void _animationSystem::printStats()
+{
+    printf("---- Animation ----\n");
+    printf("instances %d: sampled %d, blended %d, culled %d (%d updates skipped)\n",
+           (int)instances.size(), sampledCount, blendedCount, culledCount, blendedCount + culledCount);
+    if (skinnedVerts > 0 || morphedVerts > 0) {
+        printf("morphed %d, skinned %d vertices in %.3f ms\n", morphedVerts, skinnedVerts, skinMs);
+    }
+}
+
+void _animationSystem::report()
+{
+    if (reportTime < reportInterval || reportFrames == 0) return;
+
+    // LOD frames only blend, culled instances only move their clock: both skip the clip sample
+    double perFrame = 1.0 / reportFrames;
+    printf("Animation: %d instances, %.1f of %.1f updates skipped per frame (%.1f blended, %.1f culled) over %d frames\n",
+           (int)instances.size(), (reportBlended + reportCulled) * perFrame,
+           (reportSampled + reportBlended + reportCulled) * perFrame,
+           reportBlended * perFrame, reportCulled * perFrame, reportFrames);
+
+    reportTime = 0.0f;
+    reportFrames = 0;
+    reportSampled = reportBlended = reportCulled = 0;
+}
+
+void _animationSystem::benchmark(GltfModel *model, int count, int frames)
+{
+    if (!model || model->clips.empty() || count <= 0 || frames <= 0) return;
+
+    std::vector<_animInstance *> crowd;
+    for (int i = 0; i < count; ++i) {
+        _animInstance *inst = new _animInstance(model);
+        inst->setTime(i * 0.037f);                          //spread out so cursors are not in lockstep
+        inst->lodSlot = i;
+        crowd.push_back(inst);
+    }
+
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    if (maxThreads < 1) maxThreads = 1;
+
+    printf("---- Animation update: %d instances, %d frames ----\n", count, frames);
+
+    double baseMs = 0.0;
+    for (int threads = 1; threads <= maxThreads; ++threads)
+    {
+        _animationSystem sys(threads);
+        sys.instances = crowd;
+        sys.update(1.0f / 60.0f);                           //warm up caches and worker threads
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; ++f) sys.update(1.0f / 60.0f);
+        auto t1 = std::chrono::steady_clock::now();
+
+        double ms = std::chrono::duration<double, std::milli>(t1 - t0).count() / frames;
+        if (threads == 1) baseMs = ms;
+
+        printf("threads %2d: %7.3f ms/frame  speedup %.2fx", threads, ms, ms > 0.0 ? baseMs / ms : 0.0);
+        if (sys.skinnedVerts > 0) printf("  skinning %.0f verts/ms", sys.skinMs > 0.0 ? sys.skinnedVerts / sys.skinMs : 0.0);
+        printf("\n");
+    }
+
+    // ---- Same crowd spread over 0..100 units with every 8th one culled ----
+    for (int i = 0; i < count; ++i) {
+        crowd[i]->position.x = 100.0f * i / count;
+        crowd[i]->visible = (i % 8) != 0;
+    }
+
+    _animationSystem sys(1);
+    sys.instances = crowd;
+    sys.update(1.0f / 60.0f);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) sys.update(1.0f / 60.0f);
+    auto t1 = std::chrono::steady_clock::now();
+
+    printf("with LOD (%.0f / %.0f units), 1 thread: %.3f ms/frame\n", sys.lodDistance[0], sys.lodDistance[1],
+           std::chrono::duration<double, std::milli>(t1 - t0).count() / frames);
+    sys.printStats();
+
+    for (_animInstance *inst : crowd) delete inst;
+}
@@ -0,0 +1,253 @@
+#include "_assetLoader.h"
+#include <stdio.h>
+#include "_textureBaker.h"
+
+_assetLoader::_assetLoader(int numThreads)
+{
+    //ctor
+    startTime = std::chrono::steady_clock::now();
+    pool = new _threadPool(numThreads);
+}
+
+_assetLoader::~_assetLoader()
+{
+    //dtor
+    delete pool;                            //joins workers before jobs go away
+
+    for (assetJob *job : jobs) {
+        if (job->pixels) SOIL_free_image_data(job->pixels);
+        delete job;
+    }
+}
+
+double _assetLoader::now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+int _assetLoader::loadTexture(_textureLoader *tex, const char *fileName, GLuint *outID)
+{
+    assetJob *job = new assetJob();
+    job->type = TEXTURE;
+    job->fileName = fileName;
+    job->tex = tex;
+    job->outID = outID;
+
+    return addJob(job);
+}
+
+int _assetLoader::loadModel(_gltfLoader *loader, const std::string &fileName, GltfModel **outModel)
+{
+    assetJob *job = new assetJob();
+    job->type = MODEL;
+    job->fileName = fileName;
+    job->gltf = loader;
+    job->outModel = outModel;
+
+    if (outModel) *outModel = nullptr;      //resolves in upload()
+
+    return addJob(job);
+}
+
+int _assetLoader::loadMD2(_3DModelLoader *mdl, const char *fileName)
+{
+    assetJob *job = new assetJob();
+    job->type = MD2;
+    job->fileName = fileName;
+    job->md2 = mdl;
+
+    return addJob(job);
+}
+
+int _assetLoader::addJob(assetJob *job)
+{
+    int handle = (int)jobs.size();
+    jobs.push_back(job);
+
+    pool->submit([this, job] { decode(job); });
+
+    return handle;
+}
+
+bool _assetLoader::isReady(int handle)
+{
+    if (handle < 0 || handle >= (int)jobs.size()) return false;
+
+    assetJob *job = jobs[handle];
+    if (job->uploaded && streamer && job->type == TEXTURE) return !streamer->isStreaming(job->texID);
+    return job->uploaded;
+}
+
+void _assetLoader::decode(assetJob *job)
+{
+    job->worker = pool->workerIndex();
+    job->decodeStart = now();
+
+    switch (job->type)
+    {
+        case TEXTURE:
+        {
+            _textureCache *cache = _textureCache::instance();
+            job->path = _textureCache::canonicalPath(job->fileName.c_str());
+
+            // already resident: resolve from the cache at upload time, no decode
+            if (cache->contains(job->path, 0)) { job->ok = true; break; }
+
+            // baked .dds next to the source and not older than it: just read it, upload parses the levels
+            if (_textureBaker::bakeIsCurrent(job->fileName.c_str())
+                && _textureCache::readFile(_textureBaker::bakedPath(job->fileName.c_str()).c_str(), job->baked)) {
+                job->hash = _textureCache::hashBytes(job->baked.data(), job->baked.size());
+                job->ok = true;
+                break;
+            }
+
+            std::vector<unsigned char> bytes;
+            if (!_textureCache::readFile(job->fileName.c_str(), bytes)) {
+                cout << "Error : *****file did not load*****" << endl;
+                break;
+            }
+
+            job->hash = _textureCache::hashBytes(bytes.data(), bytes.size());
+            if (cache->contains(job->path, job->hash)) { job->ok = true; break; }
+
+            job->pixels = _textureLoader::decodeTexture(bytes.data(), (int)bytes.size(), &job->width, &job->height);
+            job->ok = job->pixels != nullptr;
+            break;
+        }
+
+        case MODEL:
+            job->model = job->gltf->parseModel(job->fileName);
+            job->ok = job->model != nullptr;
+            break;
+
+        case MD2:
+            job->ok = job->md2->ReadMD2Model(job->fileName.c_str(), &job->md2->md2file) != 0;
+            break;
+    }
+
+    job->decodeEnd = now();
+    job->decoded.store(true, std::memory_order_release);
+}
+
+void _assetLoader::upload(assetJob *job)
+{
+    job->uploadStart = now();
+
+    switch (job->type)
+    {
+        case TEXTURE:
+            if (job->ok) {
+                if (job->tex->acquireCached(job->path, job->hash)) {
+                    // another job or loader got there first
+                    if (job->pixels) SOIL_free_image_data(job->pixels);
+                }
+                else if (!job->baked.empty() && job->tex->uploadDDS(job->baked.data(), job->baked.size())) {
+                    job->tex->addToCache(job->path, job->hash, job->fileName.c_str());
+                }
+                else if (!job->pixels) {
+                    // cache entry was released between decode and upload
+                    job->tex->loadTexture((char*)job->fileName.c_str());
+                }
+                else {
+                    if (streamer) {
+                        job->tex->streamTexture(job->pixels, job->width, job->height, streamer);
+                    }
+                    else {
+                        job->tex->uploadTexture(job->pixels, job->width, job->height);
+                        SOIL_free_image_data(job->pixels);
+                    }
+                    job->tex->addToCache(job->path, job->hash, job->fileName.c_str());
+
+                    // half-streamed textures must not be evicted under the streamer's feet
+                    if (streamer) _textureResidency::instance()->setPinned(job->tex->textID, true);
+                }
+                job->pixels = nullptr;
+                job->baked.clear();
+                job->baked.shrink_to_fit();
+                job->texID = job->tex->textID;
+
+                if (job->outID) *job->outID = job->texID;
+            }
+            break;
+
+        case MODEL:
+            if (job->ok) job->gltf->uploadModel(job->model);
+            if (job->outModel) *job->outModel = job->model;
+            break;
+
+        case MD2:
+            if (!job->ok) exit (EXIT_FAILURE);      //same as _3DModelLoader::initModel
+            job->md2->loadSkins(&job->md2->md2file);
+            job->md2->UploadBuffers();
+            break;
+    }
+
+    job->uploadEnd = now();
+    job->uploaded = true;
+}
+
+void _assetLoader::update()
+{
+    for (assetJob *job : jobs) {
+        if (!job->uploaded && job->decoded.load(std::memory_order_acquire)) {
+            upload(job);
+        }
+    }
+}
+
+void _assetLoader::finishAll()
+{
+    while (true)
+    {
+        update();
+
+        bool done = true;
+        for (assetJob *job : jobs) {
+            if (!job->uploaded) { done = false; break; }
+        }
+        if (done) return;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void _assetLoader::printTimeline()
+{
+    if (jobs.empty()) return;
+
+    // ---- Span covered by all jobs ----
+    double first = jobs[0]->decodeStart, last = 0;
+    double serial = 0;
+    for (assetJob *job : jobs) {
+        if (job->decodeStart < first) first = job->decodeStart;
+        if (job->uploadEnd > last) last = job->uploadEnd;
+        serial += (job->decodeEnd - job->decodeStart) + (job->uploadEnd - job->uploadStart);
+    }
+    double wall = last - first;
+    if (wall <= 0) wall = 1;
+
+    const int cols = 50;
+    const char *names[] = {"tex", "gltf", "md2"};
+
+    printf("---- Asset timeline (%d workers, '-' decode, '#' upload) ----\n", pool->threadCount());
+    for (assetJob *job : jobs)
+    {
+        char bar[cols + 1];
+        memset(bar, ' ', cols);
+        bar[cols] = 0;
+
+        int d0 = (int)((job->decodeStart - first) / wall * cols);
+        int d1 = (int)((job->decodeEnd   - first) / wall * cols);
+        int u0 = (int)((job->uploadStart - first) / wall * cols);
+        int u1 = (int)((job->uploadEnd   - first) / wall * cols);
+
+        for (int c = d0; c <= d1 && c < cols; ++c) bar[c] = '-';
+        for (int c = u0; c <= u1 && c < cols; ++c) bar[c] = '#';
+
+        printf("%-4s w%-2d |%s| %7.1f - %7.1f ms  %s%s\n",
+               names[job->type], job->worker, bar,
+               job->decodeStart - first, job->uploadEnd - first,
+               job->fileName.c_str(), job->ok ? "" : " (FAILED)");
+    }
+    printf("wall %.1f ms, serial %.1f ms, overlap x%.2f\n", wall, serial, serial / wall);
+}
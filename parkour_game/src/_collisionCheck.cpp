@@ -1,4 +1,5 @@
 #include "_collisionCheck.h"
+#include <algorithm>
 
 // ---------- BASIC VEC2/VEC3 MATH (NO GLM) ----------
 inline vec3 v3add(const vec3& a, const vec3& b) {
@@ -154,7 +155,7 @@ bool _collisionCheck::aabbOverlap(const vec3& minA, const vec3& maxA,
 // -------------------------------------------------------------
 bool _collisionCheck::rayIntersectTriangle(const vec3& orig, const vec3& dir,
                                            const vec3& v0, const vec3& v1, const vec3& v2,
-                                           float& outT, float& outU, float& outV)
+                                           float& outT, float& outU, float& outV) const
 {
     const float EPS = 1e-8f;
 
@@ -225,3 +226,126 @@ float _collisionCheck::pointPlaneSignedDistance(const vec3& point,
     vec3 N = v3normalize(planeNormal);
     return v3dot( v3sub(point, planePoint), N );
 }
+
+
+// -------------------------------------------------------------
+// BVH: median split on the longest centroid axis, <= 4 triangles per leaf
+// -------------------------------------------------------------
+void _collisionCheck::buildBVH(const std::vector<Triangle>& triangles)
+{
+    bvhTris = triangles;
+    bvhNodes.clear();
+    if (bvhTris.empty()) return;
+
+    bvhNodes.reserve(bvhTris.size() * 2);
+    bvhNode root;
+    root.first = 0;
+    root.count = (int)bvhTris.size();
+    bvhNodes.push_back(root);
+    splitBVH(0, 0);
+}
+
+void _collisionCheck::splitBVH(int node, int depth)
+{
+    int first = bvhNodes[node].first;
+    int count = bvhNodes[node].count;
+
+    // bounds of the triangles and of their centroids
+    float mn[3]  = { 1e30f,  1e30f,  1e30f}, mx[3]  = {-1e30f, -1e30f, -1e30f};
+    float cmn[3] = { 1e30f,  1e30f,  1e30f}, cmx[3] = {-1e30f, -1e30f, -1e30f};
+    for (int i = first; i < first + count; i++)
+    {
+        const Triangle& t = bvhTris[i];
+        const vec3* v[3] = {&t.a, &t.b, &t.c};
+        for (int k = 0; k < 3; k++) {
+            const float p[3] = {v[k]->x, v[k]->y, v[k]->z};
+            for (int a = 0; a < 3; a++) { mn[a] = fmin(mn[a], p[a]); mx[a] = fmax(mx[a], p[a]); }
+        }
+        const float c[3] = {(t.a.x + t.b.x + t.c.x) / 3, (t.a.y + t.b.y + t.c.y) / 3, (t.a.z + t.b.z + t.c.z) / 3};
+        for (int a = 0; a < 3; a++) { cmn[a] = fmin(cmn[a], c[a]); cmx[a] = fmax(cmx[a], c[a]); }
+    }
+    for (int a = 0; a < 3; a++) { bvhNodes[node].mn[a] = mn[a]; bvhNodes[node].mx[a] = mx[a]; }
+
+    if (count <= 4 || depth >= 48) return;
+
+    int axis = 0;
+    for (int a = 1; a < 3; a++) if (cmx[a] - cmn[a] > cmx[axis] - cmn[axis]) axis = a;
+    if (cmx[axis] - cmn[axis] <= 0) return;                    // all centroids coincide
+
+    auto centroid = [axis](const Triangle& t) {
+        return axis == 0 ? t.a.x + t.b.x + t.c.x : axis == 1 ? t.a.y + t.b.y + t.c.y : t.a.z + t.b.z + t.c.z;
+    };
+    int mid = first + count / 2;
+    std::nth_element(bvhTris.begin() + first, bvhTris.begin() + mid, bvhTris.begin() + first + count,
+                     [&](const Triangle& a, const Triangle& b) { return centroid(a) < centroid(b); });
+
+    // children are allocated as a pair, so the right one is always left + 1
+    int left = (int)bvhNodes.size();
+    bvhNode l, r;
+    l.first = first; l.count = mid - first;
+    r.first = mid;   r.count = first + count - mid;
+    bvhNodes.push_back(l);
+    bvhNodes.push_back(r);
+
+    bvhNodes[node].first = left;
+    bvhNodes[node].count = 0;
+
+    splitBVH(left, depth + 1);
+    splitBVH(left + 1, depth + 1);
+}
+
+bool _collisionCheck::segmentBlocked(const vec3& from, const vec3& to) const
+{
+    return segmentHits(from, to, true) > 0;
+}
+
+int _collisionCheck::segmentCrossings(const vec3& from, const vec3& to) const
+{
+    return segmentHits(from, to, false);
+}
+
+int _collisionCheck::segmentHits(const vec3& from, const vec3& to, bool firstOnly) const
+{
+    if (bvhNodes.empty()) return 0;
+
+    // dir is left unnormalised so t runs 0..1 along the segment
+    vec3 dir = v3sub(to, from);
+    const float o[3] = {from.x, from.y, from.z};
+    const float inv[3] = {1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z};   // +-inf on zero components is fine for the slabs
+    const float tMax = 1.0f - 1e-4f;
+
+    int stack[64];                  // depth is capped at 48 in splitBVH
+    int top = 0;
+    int hits = 0;
+    stack[top++] = 0;
+
+    while (top > 0)
+    {
+        const bvhNode& n = bvhNodes[stack[--top]];
+
+        // slab test against the segment
+        float t0 = 0.0f, t1 = tMax;
+        for (int a = 0; a < 3 && t0 <= t1; a++) {
+            float ta = (n.mn[a] - o[a]) * inv[a];
+            float tb = (n.mx[a] - o[a]) * inv[a];
+            if (ta > tb) std::swap(ta, tb);
+            if (ta == ta) t0 = fmax(t0, ta);                     // NaN when the origin lies on a slab of a flat box
+            if (tb == tb) t1 = fmin(t1, tb);
+        }
+        if (t0 > t1) continue;
+
+        if (n.count > 0) {
+            for (int i = n.first; i < n.first + n.count; i++) {
+                float t, u, v;
+                const Triangle& tri = bvhTris[i];
+                if (!rayIntersectTriangle(from, dir, tri.a, tri.b, tri.c, t, u, v) || t >= tMax) continue;
+                if (firstOnly) return 1;
+                hits++;
+            }
+        } else {
+            stack[top++] = n.first;
+            stack[top++] = n.first + 1;
+        }
+    }
+    return hits;
+}
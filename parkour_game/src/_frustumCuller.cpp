@@ -0,0 +1,130 @@
+#include "_frustumCuller.h"
+#include <algorithm>
+#include <emmintrin.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <math.h>
+#include <stdio.h>
+
+_frustumCuller::_frustumCuller()
+{
+    //ctor
+    extract(glm::mat4(1.0f));
+}
+
+_frustumCuller::~_frustumCuller()
+{
+    //dtor
+}
+
+void _frustumCuller::extract()
+{
+    float projection[16], modelview[16];
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+
+    extract(glm::make_mat4(projection) * glm::make_mat4(modelview));
+}
+
+void _frustumCuller::extract(const glm::mat4 &m)
+{
+    viewProj = m;
+
+    // ---- Gribb/Hartmann: each plane is row 3 plus or minus row 0, 1 or 2 ----
+    for (int p = 0; p < 6; ++p)
+    {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;           //left, right, bottom, top, near, far
+
+        float plane[4];
+        for (int c = 0; c < 4; ++c) plane[c] = m[c][3] + sign * m[c][row];
+
+        float len = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (len <= 0.0f) len = 1.0f;
+        for (int c = 0; c < 4; ++c) planes[p][c] = plane[c] / len;
+    }
+
+    count = 0;
+    cx.clear(); cy.clear(); cz.clear();
+    ex.clear(); ey.clear(); ez.clear();
+    radius.clear();
+}
+
+int _frustumCuller::add(const GltfModel::Bounds &b, const glm::mat4 &world)
+{
+    // ---- Box: centre through the matrix, extents through |M| (Arvo) ----
+    glm::vec3 c = glm::vec3(world * glm::vec4(b.center, 1.0f));
+    glm::vec3 e = (b.max - b.min) * 0.5f;
+
+    glm::vec3 col0 = glm::vec3(world[0]), col1 = glm::vec3(world[1]), col2 = glm::vec3(world[2]);
+    glm::vec3 we = glm::abs(col0) * e.x + glm::abs(col1) * e.y + glm::abs(col2) * e.z;
+
+    // ---- Sphere: radius scaled by the largest axis scale ----
+    float scale = sqrtf(std::max(glm::dot(col0, col0), std::max(glm::dot(col1, col1), glm::dot(col2, col2))));
+
+    cx.push_back(c.x); cy.push_back(c.y); cz.push_back(c.z);
+    ex.push_back(we.x); ey.push_back(we.y); ez.push_back(we.z);
+    radius.push_back(b.radius * scale);
+
+    return count++;
+}
+
+int _frustumCuller::add(const GltfModel *model, const glm::mat4 &world)
+{
+    const glm::mat4 *root = model->rootTransform();
+    return add(model->bounds, root ? world * *root : world);
+}
+
+void _frustumCuller::cull()
+{
+    // pad to a whole number of lanes; the padding lanes are never read back
+    int padded = (count + 3) & ~3;
+    cx.resize(padded, 0.0f); cy.resize(padded, 0.0f); cz.resize(padded, 0.0f);
+    ex.resize(padded, 0.0f); ey.resize(padded, 0.0f); ez.resize(padded, 0.0f);
+    radius.resize(padded, 0.0f);
+    visibleFlags.resize(padded);
+
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    // ---- Four instances against all six planes per iteration ----
+    submitted = 0;
+    for (int i = 0; i < padded; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&cx[i]), y = _mm_loadu_ps(&cy[i]), z = _mm_loadu_ps(&cz[i]);
+        __m128 hx = _mm_loadu_ps(&ex[i]), hy = _mm_loadu_ps(&ey[i]), hz = _mm_loadu_ps(&ez[i]);
+        __m128 r = _mm_loadu_ps(&radius[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            __m128 a = _mm_set1_ps(planes[p][0]);
+            __m128 b = _mm_set1_ps(planes[p][1]);
+            __m128 c = _mm_set1_ps(planes[p][2]);
+
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)),
+                                     _mm_add_ps(_mm_mul_ps(c, z), _mm_set1_ps(planes[p][3])));
+
+            // both volumes share the centre, so the tighter reach along this normal decides
+            __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(a, absMask), hx), _mm_mul_ps(_mm_and_ps(b, absMask), hy)),
+                                    _mm_mul_ps(_mm_and_ps(c, absMask), hz));
+            __m128 reach = _mm_min_ps(box, r);
+
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), reach)));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int k = 0; k < 4; ++k) {
+            visibleFlags[i + k] = !(mask & (1 << k));
+            if (i + k < count && visibleFlags[i + k]) submitted++;
+        }
+    }
+    culled = count - submitted;
+}
+
+void _frustumCuller::report()
+{
+    if (submitted == reportedSubmitted && culled == reportedCulled) return;
+
+    printf("Frustum: %d submitted, %d culled\n", submitted, culled);
+    reportedSubmitted = submitted;
+    reportedCulled = culled;
+}
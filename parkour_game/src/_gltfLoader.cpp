@@ -13,6 +13,15 @@ _gltfLoader::~_gltfLoader() {
 }
 
 GltfModel* _gltfLoader::loadModel(const std::string& filename)
+{
+    GltfModel* model = parseModel(filename);
+    if (!model) return nullptr;
+
+    uploadModel(model);
+    return model;
+}
+
+GltfModel* _gltfLoader::parseModel(const std::string& filename)
 {
     GltfModel* model = new GltfModel();
 
@@ -49,20 +58,14 @@ GltfModel* _gltfLoader::loadModel(const std::string& filename)
                 const unsigned char* buffer = (const unsigned char*)img->buffer_view->buffer->data + img->buffer_view->offset;
                 size_t size = img->buffer_view->size;
 
-                GLuint texID;
-                glGenTextures(1, &texID);
-                glBindTexture(GL_TEXTURE_2D, texID);
-
+                // decode only; the GL texture is created later in uploadModel()
                 int w, h, channels;
                 unsigned char* imageData = SOIL_load_image_from_memory(buffer, (int)size, &w, &h, &channels, SOIL_LOAD_RGBA);
                 if (imageData) {
-                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                    SOIL_free_image_data(imageData);
-
-                    model->textureID = texID;
-                    std::cout << "GLTF: Embedded texture loaded, ID = " << texID << "\n";
+                    model->embeddedHash = _textureCache::hashBytes(buffer, size);
+                    model->embeddedImage = imageData;
+                    model->embeddedWidth = w;
+                    model->embeddedHeight = h;
                 } else {
                     std::cerr << "GLTF: Failed to load embedded texture\n";
                 }
@@ -70,15 +73,45 @@ GltfModel* _gltfLoader::loadModel(const std::string& filename)
         }
     }
 
+    // ---- Skin: joint nodes and inverse bind matrices (first skin only) ----
+    if (data->skins_count > 0) {
+        cgltf_skin& skin = data->skins[0];
+        for (size_t j = 0; j < skin.joints_count; ++j) {
+            glm::mat4 ibm(1.0f);
+            if (skin.inverse_bind_matrices) {
+                cgltf_accessor_read_float(skin.inverse_bind_matrices, j, &ibm[0][0], 16);
+            }
+            model->skinJoints.push_back((int)(skin.joints[j] - data->nodes));
+            model->inverseBindMatrices.push_back(ibm);
+        }
+    }
+
     // ---- MESH LOOP ----
+    std::vector<int> meshSlot(data->meshes_count, -1);
     for (size_t m = 0; m < data->meshes_count; ++m)
     {
         cgltf_mesh& mesh = data->meshes[m];
+
+        // one weight slot per morph target, shared by every primitive of the mesh
+        size_t targetCount = 0;
+        for (size_t p = 0; p < mesh.primitives_count; ++p) {
+            if (mesh.primitives[p].targets_count > targetCount) targetCount = mesh.primitives[p].targets_count;
+        }
+        if (targetCount > 0) {
+            meshSlot[m] = (int)model->morphWeights.size();
+            for (size_t t = 0; t < targetCount; ++t) {
+                model->morphWeights.push_back(t < mesh.weights_count ? mesh.weights[t] : 0.0f);
+            }
+        }
+
         for (size_t p = 0; p < mesh.primitives_count; ++p)
         {
             cgltf_primitive& prim = mesh.primitives[p];
             if (prim.type != cgltf_primitive_type_triangles) continue;
 
+            // primitives are appended to one vertex array, so their indices need this offset
+            size_t baseVertex = model->vertices.size() / 3;
+
             // --- Attributes ---
             for (size_t a = 0; a < prim.attributes_count; ++a)
             {
@@ -107,24 +140,149 @@ GltfModel* _gltfLoader::loadModel(const std::string& filename)
                         model->normals.push_back(n[1]);
                         model->normals.push_back(n[2]);
                     }
+                } else if (attr.type == cgltf_attribute_type_joints && attr.index == 0 && !model->skinJoints.empty()) {
+                    // u8 or u16 in the file
+                    for (size_t i = 0; i < accessor->count; ++i) {
+                        cgltf_uint j[4] = {0, 0, 0, 0};
+                        cgltf_accessor_read_uint(accessor, i, j, 4);
+                        for (int k = 0; k < 4; ++k) {
+                            model->joints.push_back((unsigned short)(j[k] < model->skinJoints.size() ? j[k] : 0));
+                        }
+                    }
+                } else if (attr.type == cgltf_attribute_type_weights && attr.index == 0 && !model->skinJoints.empty()) {
+                    // float or normalized u8/u16 in the file
+                    for (size_t i = 0; i < accessor->count; ++i) {
+                        float w[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+                        cgltf_accessor_read_float(accessor, i, w, 4);
+                        for (int k = 0; k < 4; ++k) model->weights.push_back(w[k]);
+                    }
+                }
+            }
+
+            // unskinned primitive in a skinned model: bind it rigidly to joint 0
+            if (!model->skinJoints.empty()) {
+                size_t verts = model->vertices.size() / 3;
+                while (model->joints.size() < verts * 4) model->joints.push_back(0);
+                while (model->weights.size() < verts * 4) model->weights.push_back(model->weights.size() % 4 == 0 ? 1.0f : 0.0f);
+            }
+
+            // --- Morph targets: deltas against this primitive's vertices (sparse accessors included) ---
+            size_t primVerts = model->vertices.size() / 3 - baseVertex;
+            for (size_t t = 0; t < prim.targets_count; ++t)
+            {
+                std::vector<float> dp(primVerts * 4, 0.0f), dn;
+                for (size_t a = 0; a < prim.targets[t].attributes_count; ++a)
+                {
+                    cgltf_attribute& attr = prim.targets[t].attributes[a];
+                    std::vector<float>* dst = attr.type == cgltf_attribute_type_position ? &dp
+                                            : attr.type == cgltf_attribute_type_normal ? &dn : nullptr;
+                    if (!dst) continue;
+                    dst->assign(primVerts * 4, 0.0f);
+
+                    size_t count = attr.data->count < primVerts ? attr.data->count : primVerts;
+                    for (size_t i = 0; i < count; ++i) {
+                        cgltf_accessor_read_float(attr.data, i, &(*dst)[i * 4], 3);
+                    }
+                }
+
+                // keep only the span of vertices the target actually moves
+                size_t lo = primVerts, hi = 0;
+                for (size_t i = 0; i < primVerts * 4; ++i) {
+                    if (dp[i] != 0.0f || (!dn.empty() && dn[i] != 0.0f)) {
+                        if (i / 4 < lo) lo = i / 4;
+                        hi = i / 4 + 1;
+                    }
+                }
+                if (lo >= hi) continue;
+
+                GltfModel::MorphTarget target;
+                target.weight = meshSlot[m] + (int)t;
+                target.firstVertex = (int)(baseVertex + lo);
+                target.vertexCount = (int)(hi - lo);
+                for (size_t i = lo; i < hi; ++i) {
+                    target.dx.push_back(dp[i * 4]);
+                    target.dy.push_back(dp[i * 4 + 1]);
+                    target.dz.push_back(dp[i * 4 + 2]);
+                    if (dn.empty()) continue;
+                    target.nx.push_back(dn[i * 4]);
+                    target.ny.push_back(dn[i * 4 + 1]);
+                    target.nz.push_back(dn[i * 4 + 2]);
                 }
+                model->morphTargets.push_back(target);
             }
 
             // --- Indices ---
+            size_t firstIndex = model->indices.size();
             if (prim.indices) {
                 cgltf_accessor* accessor = prim.indices;
                 for (size_t i = 0; i < accessor->count; ++i) {
                     unsigned int idx = 0;
                     cgltf_accessor_read_uint(accessor, i, &idx, 1);
-                    model->indices.push_back(idx);
+                    model->indices.push_back((unsigned int)(idx + baseVertex));
                 }
             }
+
+            // ranges only; computeBounds() fills in the bounds once every target is known
+            GltfModel::Submesh sub;
+            sub.firstVertex = (int)baseVertex;
+            sub.vertexCount = (int)primVerts;
+            sub.firstIndex = (int)firstIndex;
+            sub.indexCount = (int)(model->indices.size() - firstIndex);
+            model->submeshes.push_back(sub);
         }
     }
 
-    // Upload to GPU
-    model->uploadToGPU();
+    // weights are animated per node, so map each node to its mesh's slots
+    model->morphSlot.assign(data->nodes_count, -1);
+    for (size_t n = 0; n < data->nodes_count; ++n) {
+        if (data->nodes[n].mesh) model->morphSlot[n] = meshSlot[data->nodes[n].mesh - data->meshes];
+    }
+
     model->setCgltfData(data);
+    model->buildAnimationClips();
+    model->buildHierarchy();
+    model->computeBounds();
 
     return model;
 }
+
+void _gltfLoader::uploadModel(GltfModel* model)
+{
+    if (!model) return;
+
+    // ---- Embedded texture decoded by parseModel() ----
+    if (model->embeddedImage) {
+        _textureCache *cache = _textureCache::instance();
+
+        GLuint texID = cache->acquire("", model->embeddedHash, nullptr, nullptr);
+        if (texID) {
+            // identical image already embedded in another model
+            SOIL_free_image_data(model->embeddedImage);
+            model->embeddedImage = nullptr;
+            model->textureID = texID;
+            model->embeddedTexture = texID;
+        }
+    }
+
+    if (model->embeddedImage) {
+        GLuint texID;
+        glGenTextures(1, &texID);
+        glBindTexture(GL_TEXTURE_2D, texID);
+
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, model->embeddedWidth, model->embeddedHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, model->embeddedImage);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        SOIL_free_image_data(model->embeddedImage);
+        model->embeddedImage = nullptr;
+
+        _textureCache::instance()->insert("", model->embeddedHash, texID, model->embeddedWidth, model->embeddedHeight,
+                                          (long long)model->embeddedWidth * model->embeddedHeight * 4);
+
+        model->textureID = texID;
+        model->embeddedTexture = texID;
+        std::cout << "GLTF: Embedded texture loaded, ID = " << texID << "\n";
+    }
+
+    // Upload to GPU
+    model->uploadToGPU();
+}
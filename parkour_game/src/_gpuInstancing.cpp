@@ -0,0 +1,118 @@
+#include "_gpuInstancing.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <string.h>
+
+// Lit by _shader::litFragmentSource
+static const char *instanceVertexSource =
+    "#version 120\n"
+    "attribute mat4 instanceMatrix;\n"
+    "attribute vec4 instanceColor;\n"
+    "varying vec3 normal;\n"
+    "varying vec3 eyePos;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 p = instanceMatrix * gl_Vertex;\n"
+    "    eyePos = vec3(gl_ModelViewMatrix * p);\n"
+    "    normal = gl_NormalMatrix * (mat3(instanceMatrix) * gl_Normal);\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = instanceColor;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * p;\n"
+    "}\n";
+
+_gpuInstancing::_gpuInstancing()
+{
+    //ctor
+}
+
+_gpuInstancing::~_gpuInstancing()
+{
+    //dtor
+}
+
+_gpuInstancing* _gpuInstancing::instance()
+{
+    static _gpuInstancing instancing;
+    return &instancing;
+}
+
+bool _gpuInstancing::init()
+{
+    if (ready) return true;
+    if (!_shader::supported() || !GLEW_ARB_instanced_arrays || !GLEW_ARB_draw_instanced) return false;
+
+    if (!shader.loadFromSource(instanceVertexSource, _shader::litFragmentSource)) return false;
+
+    matrixAttrib = shader.attribute("instanceMatrix");
+    colorAttrib = shader.attribute("instanceColor");
+    useTexture = shader.uniform("useTexture");
+    if (matrixAttrib < 0 || colorAttrib < 0) return false;
+
+    glGenBuffers(1, &instanceVBO);
+
+    shader.bind();
+    glUniform1i(shader.uniform("tex"), 0);
+    shader.unbind();
+
+    ready = true;
+    return true;
+}
+
+bool _gpuInstancing::canDraw(const GltfModel *model)
+{
+    // skinned and morphed models need their per-instance deformation, which lives in _animInstance
+    return ready && model && model->data && model->vbo && !model->isSkinned() && !model->hasMorphs();
+}
+
+void _gpuInstancing::draw(GltfModel *model, const std::vector<glm::mat4> &matrices, const std::vector<glm::vec4> &colors)
+{
+    size_t count = matrices.size();
+    if (count == 0) return;
+
+    // ---- Pack matrix + colour per instance; the root node transform goes in once here ----
+    const glm::mat4 *root = model->rootTransform();
+    staging.resize(count * 20);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        glm::mat4 m = root ? matrices[i] * *root : matrices[i];
+        glm::vec4 c = i < colors.size() ? colors[i] : glm::vec4(1.0f);
+
+        float *dst = &staging[i * 20];
+        memcpy(dst, glm::value_ptr(m), 16 * sizeof(float));
+        memcpy(dst + 16, glm::value_ptr(c), 4 * sizeof(float));
+    }
+
+    // ---- Stream; orphaning avoids waiting on the previous draw ----
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (count > instanceCapacity) instanceCapacity = count;
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * 20 * sizeof(float), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(float), staging.data());
+
+    GLsizei stride = 20 * sizeof(float);
+    for (int col = 0; col < 4; ++col) {
+        glEnableVertexAttribArray(matrixAttrib + col);
+        glVertexAttribPointer(matrixAttrib + col, 4, GL_FLOAT, GL_FALSE, stride, (void*)(col * 4 * sizeof(float)));
+        glVertexAttribDivisorARB(matrixAttrib + col, 1);
+    }
+    glEnableVertexAttribArray(colorAttrib);
+    glVertexAttribPointer(colorAttrib, 4, GL_FLOAT, GL_FALSE, stride, (void*)(16 * sizeof(float)));
+    glVertexAttribDivisorARB(colorAttrib, 1);
+
+    shader.bind();
+    glUniform1i(useTexture, model->textureID != 0);
+
+    // positions, normals and UVs straight from the static VBOs
+    model->drawGeometry(0, (GLsizei)count);
+
+    // divisors are per attribute slot, so other shaders would inherit them
+    for (int col = 0; col < 4; ++col) {
+        glVertexAttribDivisorARB(matrixAttrib + col, 0);
+        glDisableVertexAttribArray(matrixAttrib + col);
+    }
+    glVertexAttribDivisorARB(colorAttrib, 0);
+    glDisableVertexAttribArray(colorAttrib);
+    shader.unbind();
+
+    drawCalls++;
+    instancesDrawn += (int)count;
+}
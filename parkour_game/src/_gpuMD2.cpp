@@ -0,0 +1,123 @@
+#include "_gpuMD2.h"
+
+// Lit by _shader::litFragmentSource
+static const char *md2VertexSource =
+    "#version 120\n"
+    "uniform vec3 scaleA;\n"
+    "uniform vec3 translateA;\n"
+    "uniform vec3 scaleB;\n"
+    "uniform vec3 translateB;\n"
+    "uniform float interp;\n"
+    "attribute vec3 positionA;\n"
+    "attribute vec3 positionB;\n"
+    "attribute vec3 normalA;\n"
+    "attribute vec3 normalB;\n"
+    "varying vec3 normal;\n"
+    "varying vec3 eyePos;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 p = vec4(mix(positionA * scaleA + translateA, positionB * scaleB + translateB, interp), 1.0);\n"
+    "    eyePos = vec3(gl_ModelViewMatrix * p);\n"
+    "    normal = gl_NormalMatrix * mix(normalA, normalB, interp);\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * p;\n"
+    "}\n";
+
+_gpuMD2::_gpuMD2()
+{
+    //ctor
+}
+
+_gpuMD2::~_gpuMD2()
+{
+    //dtor
+}
+
+_gpuMD2* _gpuMD2::instance()
+{
+    static _gpuMD2 md2;
+    return &md2;
+}
+
+bool _gpuMD2::init()
+{
+    if (ready) return true;
+    if (!shader.loadFromSource(md2VertexSource, _shader::litFragmentSource, "positionA")) return false;
+
+    positionA = shader.attribute("positionA");
+    positionB = shader.attribute("positionB");
+    normalA = shader.attribute("normalA");
+    normalB = shader.attribute("normalB");
+    if (positionA < 0 || positionB < 0 || normalA < 0 || normalB < 0) return false;
+
+    scaleA = shader.uniform("scaleA");
+    translateA = shader.uniform("translateA");
+    scaleB = shader.uniform("scaleB");
+    translateB = shader.uniform("translateB");
+    interp = shader.uniform("interp");
+    useTexture = shader.uniform("useTexture");
+
+    shader.bind();
+    glUniform1i(shader.uniform("tex"), 0);
+    shader.unbind();
+
+    ready = true;
+    return true;
+}
+
+bool _gpuMD2::canDraw(const _3DModelLoader *mdl)
+{
+    return ready && mdl && mdl->vboFrames && mdl->iboMesh;
+}
+
+void _gpuMD2::draw(_3DModelLoader *mdl, int n, float t)
+{
+    const md2_model_t &file = mdl->md2file;
+    if (n < 0 || n > file.header.num_frames - 1) return;
+
+    const md2_frame_t *a = &file.frames[n];
+    const md2_frame_t *b = &file.frames[n + 1 < file.header.num_frames ? n + 1 : n];
+
+    shader.bind();
+    glUniform3fv(scaleA, 1, a->scale);
+    glUniform3fv(translateA, 1, a->translate);
+    glUniform3fv(scaleB, 1, b->scale);
+    glUniform3fv(translateB, 1, b->translate);
+    glUniform1f(interp, t);
+    glUniform1i(useTexture, file.tex_id != 0);
+
+    _textureResidency::instance()->bind(file.tex_id);
+
+    // ---- Point each attribute pair at its frame; 8 bytes per vertex: x,y,z,-, nx,ny,nz,- ----
+    size_t frameBytes = mdl->meshVerts.size() * 8;
+    size_t offsetA = (a - file.frames) * frameBytes;
+    size_t offsetB = (b - file.frames) * frameBytes;
+
+    glBindBuffer(GL_ARRAY_BUFFER, mdl->vboFrames);
+    glEnableVertexAttribArray(positionA);
+    glVertexAttribPointer(positionA, 3, GL_UNSIGNED_BYTE, GL_FALSE, 8, (void*)offsetA);
+    glEnableVertexAttribArray(normalA);
+    glVertexAttribPointer(normalA, 3, GL_BYTE, GL_TRUE, 8, (void*)(offsetA + 4));
+    glEnableVertexAttribArray(positionB);
+    glVertexAttribPointer(positionB, 3, GL_UNSIGNED_BYTE, GL_FALSE, 8, (void*)offsetB);
+    glEnableVertexAttribArray(normalB);
+    glVertexAttribPointer(normalB, 3, GL_BYTE, GL_TRUE, 8, (void*)(offsetB + 4));
+
+    glBindBuffer(GL_ARRAY_BUFFER, mdl->vboTexCoords);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, 0, (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mdl->iboMesh);
+    glDrawElements(GL_TRIANGLES, (GLsizei)mdl->meshIndices.size(), GL_UNSIGNED_SHORT, (void*)0);
+
+    glDisableVertexAttribArray(positionA);
+    glDisableVertexAttribArray(normalA);
+    glDisableVertexAttribArray(positionB);
+    glDisableVertexAttribArray(normalB);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    shader.unbind();
+}
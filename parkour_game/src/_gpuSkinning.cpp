@@ -0,0 +1,106 @@
+#include "_gpuSkinning.h"
+
+// Lit by _shader::litFragmentSource
+static const char *skinVertexSource =
+    "#version 120\n"
+    "#extension GL_ARB_uniform_buffer_object : require\n"
+    "layout(std140) uniform JointPalette { mat4 joints[128]; };\n"
+    "attribute vec4 jointIndices;\n"
+    "attribute vec4 jointWeights;\n"
+    "varying vec3 normal;\n"
+    "varying vec3 eyePos;\n"
+    "void main()\n"
+    "{\n"
+    "    mat4 skin = jointWeights.x * joints[int(jointIndices.x)]\n"
+    "              + jointWeights.y * joints[int(jointIndices.y)]\n"
+    "              + jointWeights.z * joints[int(jointIndices.z)]\n"
+    "              + jointWeights.w * joints[int(jointIndices.w)];\n"
+    "    vec4 p = skin * gl_Vertex;\n"
+    "    vec3 n = (skin * vec4(gl_Normal, 0.0)).xyz;\n"
+    "    eyePos = vec3(gl_ModelViewMatrix * p);\n"
+    "    normal = gl_NormalMatrix * n;\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * p;\n"
+    "}\n";
+
+_gpuSkinning::_gpuSkinning()
+{
+    //ctor
+}
+
+_gpuSkinning::~_gpuSkinning()
+{
+    //dtor
+}
+
+_gpuSkinning* _gpuSkinning::instance()
+{
+    static _gpuSkinning skinning;
+    return &skinning;
+}
+
+bool _gpuSkinning::init()
+{
+    if (ready) return true;
+    if (!_shader::supported() || !GLEW_ARB_uniform_buffer_object) return false;
+
+    if (!shader.loadFromSource(skinVertexSource, _shader::litFragmentSource)) return false;
+
+    jointAttrib = shader.attribute("jointIndices");
+    weightAttrib = shader.attribute("jointWeights");
+    useTexture = shader.uniform("useTexture");
+
+    // ---- Palette block lives at binding point 0 ----
+    GLuint block = glGetUniformBlockIndex(shader.program, "JointPalette");
+    if (block == GL_INVALID_INDEX || jointAttrib < 0 || weightAttrib < 0) return false;
+    glUniformBlockBinding(shader.program, block, 0);
+
+    glGenBuffers(1, &paletteUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, paletteUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_JOINTS * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    shader.bind();
+    glUniform1i(shader.uniform("tex"), 0);
+    shader.unbind();
+
+    ready = true;
+    return true;
+}
+
+bool _gpuSkinning::canSkin(const GltfModel *model)
+{
+    // morph targets are blended on the CPU, so those models are skinned there too
+    return ready && model && model->isSkinned() && model->jbo && model->wbo
+        && model->skinJoints.size() <= (size_t)MAX_JOINTS && !model->hasMorphs();
+}
+
+void _gpuSkinning::draw(GltfModel *model, const std::vector<glm::mat4> &palette)
+{
+    // ---- Stream this instance's palette; orphaning avoids waiting on the previous draw ----
+    glBindBuffer(GL_UNIFORM_BUFFER, paletteUBO);
+    glBufferData(GL_UNIFORM_BUFFER, MAX_JOINTS * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, palette.size() * sizeof(glm::mat4), palette.data());
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, paletteUBO);
+
+    shader.bind();
+    glUniform1i(useTexture, model->textureID != 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model->jbo);
+    glEnableVertexAttribArray(jointAttrib);
+    glVertexAttribPointer(jointAttrib, 4, GL_UNSIGNED_SHORT, GL_FALSE, 0, (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, model->wbo);
+    glEnableVertexAttribArray(weightAttrib);
+    glVertexAttribPointer(weightAttrib, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+    // bind-pose positions, normals and UVs straight from the static VBOs
+    model->drawGeometry();
+
+    glDisableVertexAttribArray(jointAttrib);
+    glDisableVertexAttribArray(weightAttrib);
+    shader.unbind();
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
@@ -12,6 +12,8 @@ _mainMenu::_mainMenu()
     myInput = nullptr;
     myCam = nullptr;
     snds = nullptr;
+    assets = nullptr;
+    streamer = nullptr;
 
     myGltfModel = nullptr;
 }
@@ -24,6 +26,8 @@ _mainMenu::~_mainMenu()
     delete myInput;
     delete myCam;
     delete snds;
+    delete assets;
+    delete streamer;
     delete myGltfModel;
 }
 
@@ -77,11 +81,15 @@ void _mainMenu::initGL()
     snds->playMusic("sounds/gameThemeForClass2.mp3");
 
 
-    // ---- Load UI Textures
-    menuTex->loadTexture("images/menuTexture.png");
-    menuUI->loadTexture("images/menuUI.png");
-    helpMenuTex->loadTexture("images/helpMenu.png");
-    helpMenuUI->loadTexture("images/helpMenuUI.png");
+    // ---- Load UI Textures (decoded on workers, streamed in over a few frames)
+    streamer = new _textureStreamer();
+    assets   = new _assetLoader(2);
+    assets->streamer = streamer;
+
+    assets->loadTexture(menuTex, "images/menuTexture.png", nullptr);
+    assets->loadTexture(menuUI, "images/menuUI.png", nullptr);
+    assets->loadTexture(helpMenuTex, "images/helpMenu.png", nullptr);
+    assets->loadTexture(helpMenuUI, "images/helpMenuUI.png", nullptr);
 }
 
 
@@ -90,6 +98,10 @@ void _mainMenu::updateScene()
 {
     myTime->updateDeltaTime();
 
+    // ---- Finish pending texture loads within the per-frame budget ----
+    assets->update();
+    streamer->update();
+
     static float smoothDT = 0.16f;
     smoothDT = (smoothDT * 0.9f) + (myTime->deltaTime * 0.1f);
 
@@ -0,0 +1,49 @@
+#include "_md2Instance.h"
+
+_md2Instance::_md2Instance(_3DModelLoader *m)
+{
+    //ctor
+    model = m;
+    setFrames(0, model->EndFrame);
+}
+
+_md2Instance::~_md2Instance()
+{
+    //dtor
+}
+
+void _md2Instance::setAction(int action)
+{
+    if (action < _3DModelLoader::STAND || action > _3DModelLoader::ATTACK) return;
+
+    const int *frames = _3DModelLoader::ActionFrames[action];
+    if (frames[0] >= 0) setFrames(frames[0], frames[1]);
+}
+
+void _md2Instance::setFrames(int first, int last)
+{
+    if (first == startFrame && last == endFrame) return;
+
+    startFrame = first;
+    endFrame = last;
+    frame = first;
+    interp = 0.0f;
+}
+
+void _md2Instance::update(float dt)
+{
+    if (frame < startFrame || frame > endFrame) frame = startFrame;
+
+    // keep the fraction past a whole frame, so playback speed does not depend on frame rate
+    interp += framesPerSecond * dt;
+    while (interp >= 1.0f) {
+        interp -= 1.0f;
+        frame++;
+        if (frame >= endFrame) frame = startFrame;
+    }
+}
+
+void _md2Instance::draw()
+{
+    model->DrawFrame(frame, interp);
+}
@@ -0,0 +1,250 @@
+#include "_occlusionCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <emmintrin.h>
+#include <math.h>
+#include <stdio.h>
+
+_occlusionCuller::_occlusionCuller(int w, int h)
+{
+    //ctor
+    width = std::max(4, (w + 3) & ~3);                      //rows are filled four pixels at a time
+    height = std::max(1, h);
+
+    // ---- Pyramid down to a single texel, each level half the last (rounded up) ----
+    int lw = width, lh = height;
+    for (;;) {
+        levels.push_back(std::vector<float>((size_t)lw * lh, 1.0f));
+        levelWidth.push_back(lw);
+        levelHeight.push_back(lh);
+        if (lw == 1 && lh == 1) break;
+        lw = std::max(1, (lw + 1) / 2);
+        lh = std::max(1, (lh + 1) / 2);
+    }
+
+    viewProj = glm::mat4(1.0f);
+    worker = new _threadPool(1);
+}
+
+_occlusionCuller::~_occlusionCuller()
+{
+    //dtor
+    delete worker;
+}
+
+void _occlusionCuller::addOccluder(GltfModel *model, const glm::mat4 &world)
+{
+    if (!model) return;
+
+    size_t count = model->vertices.size() / 3;
+    for (size_t i = 0; i + 2 < model->indices.size(); i += 3)
+    {
+        if (model->indices[i] >= count || model->indices[i + 1] >= count || model->indices[i + 2] >= count) continue;
+
+        for (int k = 0; k < 3; ++k) {
+            const float *p = &model->vertices[model->indices[i + k] * 3];
+            glm::vec3 v = glm::vec3(world * glm::vec4(p[0], p[1], p[2], 1.0f));
+            occluderVerts.push_back(v.x);
+            occluderVerts.push_back(v.y);
+            occluderVerts.push_back(v.z);
+        }
+    }
+}
+
+void _occlusionCuller::render(const glm::mat4 &vp)
+{
+    if (pending) worker->waitAll();                         //the last frame's buffer was never tested
+
+    viewProj = vp;
+    pending = true;
+    worker->submit([this] { rasterize(); });
+}
+
+void _occlusionCuller::rasterize()
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+
+    // ---- Occluders to screen space, clipped against the near plane (z >= -w) first ----
+    for (size_t i = 0; i + 9 <= occluderVerts.size(); i += 9)
+    {
+        glm::vec4 c[3];
+        float d[3];
+        int inside = 0;
+        for (int k = 0; k < 3; ++k) {
+            const float *p = &occluderVerts[i + k * 3];
+            c[k] = viewProj * glm::vec4(p[0], p[1], p[2], 1.0f);
+            d[k] = c[k].z + c[k].w;
+            if (d[k] >= 0.0f) ++inside;
+        }
+        if (inside == 0) continue;
+
+        // a triangle cut by one plane keeps at most four corners, drawn as a fan
+        glm::vec4 poly[4];
+        int n = 0;
+        for (int k = 0; k < 3; ++k) {
+            int j = (k + 1) % 3;
+            if (d[k] >= 0.0f) poly[n++] = c[k];
+            if ((d[k] >= 0.0f) != (d[j] >= 0.0f))
+                poly[n++] = c[k] + (c[j] - c[k]) * (d[k] / (d[k] - d[j]));
+        }
+
+        glm::vec4 s[4];
+        for (int k = 0; k < n; ++k) {
+            float iw = 1.0f / poly[k].w;
+            s[k] = glm::vec4((poly[k].x * iw * 0.5f + 0.5f) * width, (poly[k].y * iw * 0.5f + 0.5f) * height, poly[k].z * iw * 0.5f + 0.5f, 1.0f);
+        }
+        for (int k = 2; k < n; ++k)
+            drawTriangle(s[0], s[k - 1], s[k]);
+    }
+
+    // ---- Hi-Z: each texel keeps the farthest of the four below it ----
+    for (size_t l = 1; l < levels.size(); ++l)
+    {
+        const std::vector<float> &src = levels[l - 1];
+        int sw = levelWidth[l - 1], sh = levelHeight[l - 1];
+        std::vector<float> &dst = levels[l];
+
+        for (int y = 0; y < levelHeight[l]; ++y) {
+            int y0 = std::min(y * 2, sh - 1), y1 = std::min(y * 2 + 1, sh - 1);
+            for (int x = 0; x < levelWidth[l]; ++x) {
+                int x0 = std::min(x * 2, sw - 1), x1 = std::min(x * 2 + 1, sw - 1);
+                dst[y * levelWidth[l] + x] = std::max(std::max(src[y0 * sw + x0], src[y0 * sw + x1]),
+                                                      std::max(src[y1 * sw + x0], src[y1 * sw + x1]));
+            }
+        }
+    }
+
+    rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void _occlusionCuller::drawTriangle(const glm::vec4 &a, const glm::vec4 &b0, const glm::vec4 &c0)
+{
+    // either winding; occluders are drawn two-sided
+    float area = (b0.x - a.x) * (c0.y - a.y) - (b0.y - a.y) * (c0.x - a.x);
+    if (fabsf(area) < 1e-8f) return;
+
+    const glm::vec4 &b = area > 0.0f ? b0 : c0;
+    const glm::vec4 &c = area > 0.0f ? c0 : b0;
+    area = fabsf(area);
+
+    int minX = std::max(0, (int)floorf(std::min(a.x, std::min(b.x, c.x))));
+    int maxX = std::min(width - 1, (int)ceilf(std::max(a.x, std::max(b.x, c.x))));
+    int minY = std::max(0, (int)floorf(std::min(a.y, std::min(b.y, c.y))));
+    int maxY = std::min(height - 1, (int)ceilf(std::max(a.y, std::max(b.y, c.y))));
+    if (minX > maxX || minY > maxY) return;
+
+    // ---- Edge functions A*x + B*y + C, positive inside; depth is a plane in screen space ----
+    float A0 = a.y - b.y, B0 = b.x - a.x, C0 = -A0 * a.x - B0 * a.y;   //a -> b, opposite c
+    float A1 = b.y - c.y, B1 = c.x - b.x, C1 = -A1 * b.x - B1 * b.y;   //b -> c, opposite a
+    float A2 = c.y - a.y, B2 = a.x - c.x, C2 = -A2 * c.x - B2 * c.y;   //c -> a, opposite b
+
+    float inv = 1.0f / area;
+    float zA = (A1 * a.z + A2 * b.z + A0 * c.z) * inv;
+    float zB = (B1 * a.z + B2 * b.z + B0 * c.z) * inv;
+    float zC = (C1 * a.z + C2 * b.z + C0 * c.z) * inv;
+
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+
+    // ---- Four pixel centres per step, rows start on a multiple of four ----
+    int startX = minX & ~3;
+    for (int y = minY; y <= maxY; ++y)
+    {
+        float py = y + 0.5f;
+        __m128 rowE0 = _mm_set1_ps(B0 * py + C0);
+        __m128 rowE1 = _mm_set1_ps(B1 * py + C1);
+        __m128 rowE2 = _mm_set1_ps(B2 * py + C2);
+        __m128 rowZ = _mm_set1_ps(zB * py + zC);
+
+        float *row = &levels[0][(size_t)y * width];
+        for (int x = startX; x <= maxX; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A0), px), rowE0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A1), px), rowE1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A2), px), rowE2);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (_mm_movemask_ps(inside) == 0) continue;
+
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), rowZ);
+            __m128 depth = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(depth, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+        }
+    }
+}
+
+bool _occlusionCuller::isOccluded(const glm::vec3 &center, const glm::vec3 &extent) const
+{
+    // ---- Screen rectangle and nearest depth of the box ----
+    float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f, minZ = 1e30f;
+    for (int k = 0; k < 8; ++k)
+    {
+        glm::vec3 corner = center + glm::vec3(k & 1 ? extent.x : -extent.x,
+                                              k & 2 ? extent.y : -extent.y,
+                                              k & 4 ? extent.z : -extent.z);
+        glm::vec4 c = viewProj * glm::vec4(corner, 1.0f);
+        if (c.w < 1e-3f) return false;                      //straddles the camera
+
+        float iw = 1.0f / c.w;
+        float sx = (c.x * iw * 0.5f + 0.5f) * width;
+        float sy = (c.y * iw * 0.5f + 0.5f) * height;
+        minX = std::min(minX, sx); maxX = std::max(maxX, sx);
+        minY = std::min(minY, sy); maxY = std::max(maxY, sy);
+        minZ = std::min(minZ, c.z * iw * 0.5f + 0.5f);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return false;
+
+    int x0 = std::max(0, (int)floorf(minX)), x1 = std::min(width - 1, (int)floorf(maxX));
+    int y0 = std::max(0, (int)floorf(minY)), y1 = std::min(height - 1, (int)floorf(maxY));
+
+    // ---- Coarsest level where the rectangle spans at most 2x2 texels ----
+    size_t l = 0;
+    while (l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) l++;
+
+    const std::vector<float> &level = levels[l];
+    float farthest = 0.0f;
+    for (int y = y0 >> l; y <= (y1 >> l); ++y) {
+        for (int x = x0 >> l; x <= (x1 >> l); ++x) {
+            farthest = std::max(farthest, level[y * levelWidth[l] + x]);
+        }
+    }
+    return minZ > farthest;
+}
+
+void _occlusionCuller::cull(_frustumCuller *culler)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    tested = occluded = 0;
+    if (pending) {
+        worker->waitAll();
+        pending = false;
+    }
+
+    // only what survived the frustum
+    for (int i = 0; i < culler->instanceCount(); ++i)
+    {
+        if (!culler->visible(i)) continue;
+        tested++;
+
+        if (isOccluded(culler->worldCenter(i), culler->worldExtent(i))) {
+            culler->hide(i);
+            occluded++;
+        }
+    }
+
+    testMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void _occlusionCuller::report()
+{
+    if (tested == reportedTested && occluded == reportedOccluded) return;
+
+    printf("Occlusion: %d of %d occluded, raster %.3f ms (worker), test %.3f ms\n", occluded, tested, rasterMs, testMs);
+    reportedTested = tested;
+    reportedOccluded = occluded;
+}
@@ -0,0 +1,394 @@
+#include "_pvs.h"
+#include "_threadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+_pvs::_pvs()
+{
+    //ctor
+}
+
+_pvs::~_pvs()
+{
+    //dtor
+}
+
+unsigned int _pvs::layoutHash(const _staticBatch *batch)
+{
+    // FNV-1a over the object count and every object's world box
+    unsigned int h = 2166136261u;
+    auto mix = [&h](const void *data, size_t bytes) {
+        const unsigned char *p = (const unsigned char *)data;
+        for (size_t i = 0; i < bytes; ++i) h = (h ^ p[i]) * 16777619u;
+    };
+
+    mix(&batch->objectCount, sizeof(int));
+    for (int i = 0; i < batch->objectCount; ++i) {
+        const GltfModel::Bounds &b = batch->objectBounds(i);
+        mix(&b.min, sizeof(b.min));
+        mix(&b.max, sizeof(b.max));
+    }
+    return h;
+}
+
+void _pvs::encode(const std::vector<unsigned char> &set, std::vector<unsigned char> &out)
+{
+    // (run length, byte) pairs; sets are mostly long runs of 0x00 or 0xff
+    out.clear();
+    for (size_t i = 0; i < set.size(); )
+    {
+        size_t run = 1;
+        while (i + run < set.size() && run < 255 && set[i + run] == set[i]) run++;
+        out.push_back((unsigned char)run);
+        out.push_back(set[i]);
+        i += run;
+    }
+}
+
+bool _pvs::decode(const unsigned char *rle, size_t rleBytes, size_t setBytes, std::vector<unsigned char> &out)
+{
+    out.clear();
+    for (size_t i = 0; i + 1 < rleBytes; i += 2) {
+        if (rle[i] == 0 || out.size() + rle[i] > setBytes) return false;
+        out.insert(out.end(), rle[i], rle[i + 1]);
+    }
+    return out.size() == setBytes;
+}
+
+void _pvs::cellRuns(std::vector<unsigned int> &out) const
+{
+    // (run length, set) pairs; neighbouring cells along x mostly share a set
+    out.clear();
+    for (size_t c = 0; c < cellSet.size(); )
+    {
+        size_t run = 1;
+        while (c + run < cellSet.size() && cellSet[c + run] == cellSet[c]) run++;
+        out.push_back((unsigned int)run);
+        out.push_back(cellSet[c]);
+        c += run;
+    }
+}
+
+void _pvs::storeSets(const std::vector<unsigned char> &raw)
+{
+    size_t setBytes = (objectCount + 7) / 8;
+    size_t cells = (size_t)dims[0] * dims[1] * dims[2];
+
+    // ---- Neighbouring cells mostly see the same objects: keep each distinct set once ----
+    std::map<std::vector<unsigned char>, int> unique;
+    cellSet.assign(cells, 0);
+    sets.clear();
+    storedBytes = 0;
+
+    std::vector<unsigned char> rle;
+    for (size_t c = 0; c < cells; ++c)
+    {
+        std::vector<unsigned char> set(raw.begin() + c * setBytes, raw.begin() + (c + 1) * setBytes);
+        auto found = unique.find(set);
+        if (found == unique.end()) {
+            found = unique.insert(std::make_pair(set, (int)sets.size())).first;
+            sets.push_back(set);
+
+            encode(set, rle);
+            storedBytes += sizeof(unsigned int) + rle.size();
+        }
+        cellSet[c] = (unsigned int)found->second;
+    }
+
+    std::vector<unsigned int> runs;
+    cellRuns(runs);
+    storedBytes += sizeof(int) + runs.size() * sizeof(unsigned int);
+}
+
+void _pvs::bake(const _staticBatch *batch, float size, int raysPerPair, int threads)
+{
+    auto t0 = std::chrono::steady_clock::now();
+
+    objectCount = batch->objectCount;
+    hash = layoutHash(batch);
+    cellSize = std::max(size, 0.01f);
+    raysCast = 0;
+
+    // ---- Occluders for the BVH, and area tables to sample each object's surface ----
+    std::vector<Triangle> all;
+    std::vector<std::vector<Triangle>> surface(objectCount);
+    std::vector<std::vector<float>> areaSum(objectCount);  //running total per triangle
+    objectTriangles.assign(objectCount, 0);
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (int j = 0; j < objectCount; ++j)
+    {
+        batch->worldTriangles(j, surface[j]);
+        all.insert(all.end(), surface[j].begin(), surface[j].end());
+        objectTriangles[j] = batch->objectTriangles(j);
+
+        float total = 0.0f;
+        for (const Triangle &t : surface[j]) {
+            vec3 n = cross(t.b - t.a, t.c - t.a);
+            total += 0.5f * sqrtf(dot(n, n));
+            areaSum[j].push_back(total);
+        }
+
+        lo = glm::min(lo, batch->objectBounds(j).min);
+        hi = glm::max(hi, batch->objectBounds(j).max);
+    }
+    if (objectCount == 0) lo = hi = glm::vec3(0.0f);
+
+    _collisionCheck rays;
+    rays.buildBVH(all);
+
+    // ---- Grid over the level, with a few cells of headroom for the camera ----
+    hi.y += 3.0f * cellSize;
+    origin = lo;
+    for (int a = 0; a < 3; ++a) dims[a] = std::min(256, std::max(1, (int)ceilf((hi[a] - lo[a]) / cellSize)));
+
+    int cells = dims[0] * dims[1] * dims[2];
+    size_t setBytes = (objectCount + 7) / 8;
+    std::vector<unsigned char> raw(cells * setBytes, 0);
+
+    // ---- One cell per job, pulled off a shared counter by every thread ----
+    std::atomic<int> nextCell(0);
+    std::atomic<long long> cast(0);
+
+    auto bakeCells = [&] {
+        for (int c = nextCell.fetch_add(1); c < cells; c = nextCell.fetch_add(1))
+        {
+            int cx = c % dims[0], cy = (c / dims[0]) % dims[1], cz = c / (dims[0] * dims[1]);
+            glm::vec3 cellMin = origin + glm::vec3((float)cx, (float)cy, (float)cz) * cellSize;
+            glm::vec3 cellMax = cellMin + glm::vec3(cellSize);
+            unsigned char *set = &raw[c * setBytes];
+            long long local = 0;
+
+            // same rays whatever the thread count
+            unsigned int state = (unsigned int)c * 2654435761u | 1u;
+            auto rnd = [&state] {
+                state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+                return (state & 0xffffff) / 16777216.0f;
+            };
+
+            // ---- Eye points in the cell; those inside solid geometry are no place for a camera ----
+            std::vector<vec3> eyes;
+            for (int r = 0; r < raysPerPair; ++r) {
+                vec3 eye = {cellMin.x + rnd() * cellSize, cellMin.y + rnd() * cellSize, cellMin.z + rnd() * cellSize};
+                vec3 up = {eye.x, hi.y + cellSize, eye.z};
+                local++;
+                if ((rays.segmentCrossings(eye, up) & 1) == 0) eyes.push_back(eye);
+            }
+
+            for (int j = 0; j < objectCount; ++j)
+            {
+                // touching this cell or a neighbour: always visible
+                const GltfModel::Bounds &b = batch->objectBounds(j);
+                if (glm::all(glm::lessThanEqual(b.min, cellMax + cellSize)) && glm::all(glm::greaterThanEqual(b.max, cellMin - cellSize))) {
+                    set[j >> 3] |= 1 << (j & 7);
+                    continue;
+                }
+                if (eyes.empty() || areaSum[j].empty() || areaSum[j].back() <= 0.0f) continue;
+
+                for (int r = 0; r < raysPerPair; ++r)
+                {
+                    // area-weighted point on the object
+                    float pick = rnd() * areaSum[j].back();
+                    size_t t = std::upper_bound(areaSum[j].begin(), areaSum[j].end(), pick) - areaSum[j].begin();
+                    const Triangle &tri = surface[j][std::min(t, surface[j].size() - 1)];
+                    float u = rnd(), v = rnd();
+                    if (u + v > 1.0f) { u = 1.0f - u; v = 1.0f - v; }
+                    vec3 to = tri.a + (tri.b - tri.a) * u + (tri.c - tri.a) * v;
+
+                    local++;
+                    if (!rays.segmentBlocked(eyes[r % eyes.size()], to)) {
+                        set[j >> 3] |= 1 << (j & 7);
+                        break;
+                    }
+                }
+            }
+            cast += local;
+        }
+    };
+
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads > 1) {
+        _threadPool pool(threads - 1);
+        for (int i = 0; i < threads - 1; ++i) pool.submit(bakeCells);
+        bakeCells();
+        pool.waitAll();
+    }
+    else bakeCells();
+
+    // ---- Widen every set by its six neighbours to cover what the rays missed ----
+    std::vector<unsigned char> widened(raw);
+    const int step[3] = {1, dims[0], dims[0] * dims[1]};
+    for (int c = 0; c < cells; ++c)
+    {
+        int at[3] = {c % dims[0], (c / dims[0]) % dims[1], c / (dims[0] * dims[1])};
+        for (int a = 0; a < 3; ++a) {
+            for (int d = -1; d <= 1; d += 2) {
+                if (at[a] + d < 0 || at[a] + d >= dims[a]) continue;
+                const unsigned char *n = &raw[(c + d * step[a]) * setBytes];
+                for (size_t k = 0; k < setBytes; ++k) widened[c * setBytes + k] |= n[k];
+            }
+        }
+    }
+
+    storeSets(widened);
+
+    raysCast = cast;
+    bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool _pvs::save(const char *fileName)
+{
+    FILE *fp = fopen(fileName, "wb");
+    if (!fp) {
+        cout << "PVS: could not write " << fileName << endl;
+        return false;
+    }
+
+    int setCount = (int)sets.size();
+    fwrite("PVS2", 4, 1, fp);
+    fwrite(&origin, sizeof(float), 3, fp);
+    fwrite(&cellSize, sizeof(float), 1, fp);
+    fwrite(dims, sizeof(int), 3, fp);
+    fwrite(&objectCount, sizeof(int), 1, fp);
+    fwrite(&hash, sizeof(unsigned int), 1, fp);
+    fwrite(&setCount, sizeof(int), 1, fp);
+
+    std::vector<unsigned int> runs;
+    cellRuns(runs);
+    int runCount = (int)runs.size() / 2;
+    fwrite(&runCount, sizeof(int), 1, fp);
+    fwrite(runs.data(), sizeof(unsigned int), runs.size(), fp);
+
+    std::vector<unsigned char> rle;
+    for (const std::vector<unsigned char> &set : sets) {
+        encode(set, rle);
+        unsigned int bytes = (unsigned int)rle.size();
+        fwrite(&bytes, sizeof(bytes), 1, fp);
+        fwrite(rle.data(), 1, rle.size(), fp);
+    }
+    fclose(fp);
+    return true;
+}
+
+bool _pvs::load(const char *fileName, const _staticBatch *batch)
+{
+    FILE *fp = fopen(fileName, "rb");
+    if (!fp) {
+        cout << "PVS: no " << fileName << ", drawing without visibility sets (bake with -pvs)" << endl;
+        return false;
+    }
+
+    // ---- Header; a different object layout means the bake is stale ----
+    char magic[4];
+    int setCount = 0;
+    bool ok = fread(magic, 4, 1, fp) == 1 && memcmp(magic, "PVS2", 4) == 0
+           && fread(&origin, sizeof(float), 3, fp) == 3
+           && fread(&cellSize, sizeof(float), 1, fp) == 1
+           && fread(dims, sizeof(int), 3, fp) == 3
+           && fread(&objectCount, sizeof(int), 1, fp) == 1
+           && fread(&hash, sizeof(unsigned int), 1, fp) == 1
+           && fread(&setCount, sizeof(int), 1, fp) == 1;
+
+    ok = ok && cellSize > 0.0f && objectCount >= 0 && setCount > 0;
+    for (int a = 0; a < 3 && ok; ++a) ok = dims[a] > 0 && dims[a] <= 256;
+    ok = ok && (size_t)setCount <= (size_t)dims[0] * dims[1] * dims[2];   //at most one set per cell
+
+    bool stale = ok && (objectCount != batch->objectCount || hash != layoutHash(batch));
+    if (stale) {
+        cout << "PVS: " << fileName << " was baked for a different level layout, rebake with -pvs" << endl;
+        ok = false;
+    }
+
+    // ---- Cell table and sets ----
+    if (ok) {
+        size_t cells = (size_t)dims[0] * dims[1] * dims[2];
+        int runCount = 0;
+        ok = fread(&runCount, sizeof(int), 1, fp) == 1 && runCount > 0 && (size_t)runCount <= cells;
+
+        std::vector<unsigned int> runs(ok ? runCount * 2 : 0);
+        ok = ok && fread(runs.data(), sizeof(unsigned int), runs.size(), fp) == runs.size();
+        cellSet.clear();
+        for (size_t r = 0; r < runs.size() && ok; r += 2) {
+            ok = runs[r] > 0 && runs[r + 1] < (unsigned int)setCount && runs[r] <= cells - cellSet.size();
+            if (ok) cellSet.insert(cellSet.end(), runs[r], runs[r + 1]);
+        }
+        ok = ok && cellSet.size() == cells;
+        storedBytes = sizeof(int) + runs.size() * sizeof(unsigned int);
+    }
+
+    size_t setBytes = (objectCount + 7) / 8;
+    sets.assign(ok ? setCount : 0, std::vector<unsigned char>());
+
+    std::vector<unsigned char> rle;
+    for (int s = 0; s < setCount && ok; ++s)
+    {
+        unsigned int bytes = 0;
+        ok = fread(&bytes, sizeof(bytes), 1, fp) == 1 && bytes <= setBytes * 2;    //never longer than a pair per byte
+        rle.resize(ok ? bytes : 0);
+        ok = ok && fread(rle.data(), 1, bytes, fp) == bytes && decode(rle.data(), bytes, setBytes, sets[s]);
+        storedBytes += sizeof(bytes) + bytes;
+    }
+    fclose(fp);
+
+    if (!ok) {
+        if (!stale) cout << "PVS: " << fileName << " is damaged, rebake with -pvs" << endl;
+        cellSet.clear();
+        sets.clear();
+        dims[0] = dims[1] = dims[2] = 0;
+        return false;
+    }
+
+    objectTriangles.resize(objectCount);
+    for (int j = 0; j < objectCount; ++j) objectTriangles[j] = batch->objectTriangles(j);
+    return true;
+}
+
+const unsigned char *_pvs::visibleSet(const glm::vec3 &p) const
+{
+    if (cellSet.empty()) return nullptr;
+
+    int at[3];
+    for (int a = 0; a < 3; ++a) {
+        at[a] = (int)floorf((p[a] - origin[a]) / cellSize);
+        if (at[a] < 0 || at[a] >= dims[a]) return nullptr;
+    }
+    return sets[cellSet[(at[2] * dims[1] + at[1]) * dims[0] + at[0]]].data();
+}
+
+void _pvs::printStats(const char *level)
+{
+    size_t cells = cellSet.size();
+    if (cells == 0) return;
+
+    size_t setBytes = (objectCount + 7) / 8;
+    printf("PVS %s: %dx%dx%d cells of %.1f units, %d objects", level, dims[0], dims[1], dims[2], cellSize, objectCount);
+    if (bakeMs > 0.0) printf(", baked in %.0f ms (%lld rays)", bakeMs, raysCast);
+    printf("\n");
+
+    printf("PVS %s: %d distinct sets, %.1f KB as plain bitsets -> %.1f KB stored\n",
+           level, (int)sets.size(), cells * setBytes / 1024.0, storedBytes / 1024.0);
+
+    // ---- Draw reduction, averaged over every cell ----
+    long long totalTris = 0;
+    for (int t : objectTriangles) totalTris += t;
+
+    double objects = 0.0, tris = 0.0;
+    for (size_t c = 0; c < cells; ++c) {
+        const std::vector<unsigned char> &set = sets[cellSet[c]];
+        for (int j = 0; j < objectCount; ++j) {
+            if (!(set[j >> 3] & (1 << (j & 7)))) continue;
+            objects += 1.0;
+            tris += objectTriangles[j];
+        }
+    }
+    objects /= cells;
+    tris /= cells;
+
+    printf("PVS %s: %.1f of %d objects and %.0f of %lld triangles per cell on average (%.0f%% of the triangles culled)\n",
+           level, objects, objectCount, tris, totalTris, totalTris > 0 ? 100.0 * (1.0 - tris / totalTris) : 0.0);
+}
@@ -0,0 +1,117 @@
+#include "_shader.h"
+#include <vector>
+
+// Fixed-function style: one directional/point light, colour material, texture unit 0
+const char *_shader::litFragmentSource =
+    "#version 120\n"
+    "uniform sampler2D tex;\n"
+    "uniform int useTexture;\n"
+    "varying vec3 normal;\n"
+    "varying vec3 eyePos;\n"
+    "void main()\n"
+    "{\n"
+    "    vec4 lp = gl_LightSource[0].position;\n"
+    "    vec3 L = lp.w == 0.0 ? normalize(lp.xyz) : normalize(lp.xyz - eyePos);\n"
+    "    float d = max(dot(normalize(normal), L), 0.0);\n"
+    "    vec3 light = gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb * d;\n"
+    "    vec4 base = gl_Color;\n"
+    "    if (useTexture != 0) base *= texture2D(tex, gl_TexCoord[0].st);\n"
+    "    gl_FragColor = vec4(base.rgb * clamp(light, 0.0, 1.0), base.a);\n"
+    "}\n";
+
+_shader::_shader()
+{
+    //ctor
+}
+
+_shader::~_shader()
+{
+    //dtor
+    if (program) glDeleteProgram(program);
+}
+
+bool _shader::supported()
+{
+    return GLEW_VERSION_2_0 || (GLEW_ARB_shader_objects && GLEW_ARB_vertex_shader && GLEW_ARB_fragment_shader);
+}
+
+GLuint _shader::compile(GLenum type, const char *source)
+{
+    GLuint id = glCreateShader(type);
+    glShaderSource(id, 1, &source, NULL);
+    glCompileShader(id);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len > 1 ? len : 1, 0);
+        glGetShaderInfoLog(id, (GLsizei)log.size(), NULL, log.data());
+
+        cerr << (type == GL_VERTEX_SHADER ? "Vertex" : "Fragment") << " shader failed to compile:\n" << log.data() << endl;
+        glDeleteShader(id);
+        return 0;
+    }
+    return id;
+}
+
+bool _shader::loadFromSource(const char *vertexSource, const char *fragmentSource, const char *attribute0)
+{
+    if (!supported()) return false;
+
+    GLuint vs = compile(GL_VERTEX_SHADER, vertexSource);
+    GLuint fs = compile(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return false;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+
+    // shaders that never read gl_Vertex still need an array on location 0 to draw
+    if (attribute0) glBindAttribLocation(program, 0, attribute0);
+    glLinkProgram(program);
+
+    // the program keeps the compiled stages alive
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &len);
+        std::vector<char> log(len > 1 ? len : 1, 0);
+        glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, log.data());
+
+        cerr << "Shader program failed to link:\n" << log.data() << endl;
+        glDeleteProgram(program);
+        program = 0;
+        return false;
+    }
+    return true;
+}
+
+void _shader::bind()
+{
+    glUseProgram(program);
+}
+
+void _shader::unbind()
+{
+    glUseProgram(0);
+}
+
+GLint _shader::uniform(const char *name)
+{
+    return program ? glGetUniformLocation(program, name) : -1;
+}
+
+GLint _shader::attribute(const char *name)
+{
+    return program ? glGetAttribLocation(program, name) : -1;
+}
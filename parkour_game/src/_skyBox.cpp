@@ -38,7 +38,7 @@ void _skyBox::drawSkyBox()
 
     //front wall
 
-    glBindTexture(GL_TEXTURE_2D, tex[0]);
+    _textureResidency::instance()->bind(tex[0]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
@@ -51,7 +51,7 @@ void _skyBox::drawSkyBox()
 
     //back wall
 
-    glBindTexture(GL_TEXTURE_2D, tex[1]);
+    _textureResidency::instance()->bind(tex[1]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
@@ -64,7 +64,7 @@ void _skyBox::drawSkyBox()
 
     //top wall
 
-    glBindTexture(GL_TEXTURE_2D, tex[2]);
+    _textureResidency::instance()->bind(tex[2]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
@@ -77,7 +77,7 @@ void _skyBox::drawSkyBox()
 
     //bottom wall
 
-    glBindTexture(GL_TEXTURE_2D, tex[3]);
+    _textureResidency::instance()->bind(tex[3]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
@@ -90,7 +90,7 @@ void _skyBox::drawSkyBox()
 
     //right wall
 
-        glBindTexture(GL_TEXTURE_2D, tex[4]);
+        _textureResidency::instance()->bind(tex[4]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
@@ -103,7 +103,7 @@ void _skyBox::drawSkyBox()
 
     //left wall
 
-    glBindTexture(GL_TEXTURE_2D, tex[5]);
+    _textureResidency::instance()->bind(tex[5]);
     //glNormal3f();                                 //use this only if you are setting room with lighting
     glBegin(GL_QUADS);
 
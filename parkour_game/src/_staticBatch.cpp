@@ -0,0 +1,234 @@
+#include "_staticBatch.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+_staticBatch::_staticBatch()
+{
+    //ctor
+}
+
+_staticBatch::~_staticBatch()
+{
+    //dtor
+    for (batch &b : batches) {
+        if (b.vbo) glDeleteBuffers(1, &b.vbo);
+        if (b.ebo) glDeleteBuffers(1, &b.ebo);
+    }
+}
+
+int _staticBatch::batchFor(GLuint textureID)
+{
+    for (size_t i = 0; i < batches.size(); ++i) {
+        if (batches[i].textureID == textureID) return (int)i;
+    }
+
+    batch b;
+    b.textureID = textureID;
+    b.vbo = b.ebo = 0;
+    batches.push_back(b);
+    return (int)batches.size() - 1;
+}
+
+int _staticBatch::add(GltfModel *model, const glm::mat4 &world)
+{
+    if (!model || model->vertices.empty() || model->indices.empty()) return -1;
+
+    int slot = batchFor(model->textureID);
+    batch &b = batches[slot];
+
+    glm::mat3 linear(world);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+    bool mirrored = glm::determinant(linear) < 0.0f;         //keep front faces front under a negative scale
+
+    size_t count = model->vertices.size() / 3;
+    bool hasNormals = model->normals.size() >= count * 3;
+    bool hasUVs = model->texcoords.size() >= count * 2;
+
+    // ---- Vertices, baked into world space ----
+    unsigned int base = (unsigned int)(b.vertices.size() / 8);
+    b.vertices.reserve(b.vertices.size() + count * 8);
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (size_t v = 0; v < count; ++v)
+    {
+        const float *p = &model->vertices[v * 3];
+        glm::vec3 pos = glm::vec3(world * glm::vec4(p[0], p[1], p[2], 1.0f));
+        lo = glm::min(lo, pos);
+        hi = glm::max(hi, pos);
+
+        glm::vec3 n(0.0f, 1.0f, 0.0f);
+        if (hasNormals) {
+            const float *src = &model->normals[v * 3];
+            n = normalMatrix * glm::vec3(src[0], src[1], src[2]);
+            float len = glm::length(n);
+            if (len > 0.0f) n /= len;
+        }
+
+        float u = hasUVs ? model->texcoords[v * 2 + 0] : 0.0f;
+        float t = hasUVs ? model->texcoords[v * 2 + 1] : 0.0f;
+
+        float out[8] = {pos.x, pos.y, pos.z, n.x, n.y, n.z, u, t};
+        b.vertices.insert(b.vertices.end(), out, out + 8);
+    }
+
+    // ---- Indices, rebased onto the shared buffer ----
+    size_t firstIndex = b.indices.size();
+    b.indices.reserve(b.indices.size() + model->indices.size());
+    for (size_t i = 0; i + 2 < model->indices.size(); i += 3)
+    {
+        unsigned int i0 = model->indices[i];
+        unsigned int i1 = model->indices[i + 1];
+        unsigned int i2 = model->indices[i + 2];
+        if (i0 >= count || i1 >= count || i2 >= count) continue;
+
+        if (mirrored) std::swap(i1, i2);
+        b.indices.push_back(base + i0);
+        b.indices.push_back(base + i1);
+        b.indices.push_back(base + i2);
+        triangleCount++;
+    }
+
+    // ---- World bounds: box, and the furthest vertex from its centre ----
+    object o;
+    o.batch = slot;
+    o.firstIndex = (GLsizei)firstIndex;
+    o.indexCount = (GLsizei)(b.indices.size() - firstIndex);
+    o.bounds.min = lo;
+    o.bounds.max = hi;
+    o.bounds.center = (lo + hi) * 0.5f;
+    o.cullHandle = -1;
+
+    float r2 = 0.0f;
+    for (size_t v = base * 8; v < b.vertices.size(); v += 8) {
+        glm::vec3 d = glm::vec3(b.vertices[v], b.vertices[v + 1], b.vertices[v + 2]) - o.bounds.center;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+    o.bounds.radius = sqrtf(r2);
+
+    objects.push_back(o);
+    objectCount++;
+    return (int)objects.size() - 1;
+}
+
+void _staticBatch::worldTriangles(int i, std::vector<Triangle> &out) const
+{
+    const object &o = objects[i];
+    const batch &b = batches[o.batch];
+    if (b.indices.empty()) return;                          //released by build()
+
+    for (GLsizei k = o.firstIndex; k + 2 < o.firstIndex + o.indexCount; k += 3)
+    {
+        Triangle t;
+        vec3 *corner[3] = {&t.a, &t.b, &t.c};
+        for (int c = 0; c < 3; ++c) {
+            const float *p = &b.vertices[b.indices[k + c] * 8];
+            corner[c]->x = p[0];
+            corner[c]->y = p[1];
+            corner[c]->z = p[2];
+        }
+        out.push_back(t);
+    }
+}
+
+void _staticBatch::build()
+{
+    for (batch &b : batches)
+    {
+        if (b.vbo || b.indices.empty()) continue;
+
+        glGenBuffers(1, &b.vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+        glBufferData(GL_ARRAY_BUFFER, b.vertices.size() * sizeof(float), b.vertices.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &b.ebo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, b.indices.size() * sizeof(unsigned int), b.indices.data(), GL_STATIC_DRAW);
+
+        // the GPU copy is all draw() needs
+        std::vector<float>().swap(b.vertices);
+        std::vector<unsigned int>().swap(b.indices);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void _staticBatch::submit(_frustumCuller *culler, const unsigned char *visibleSet)
+{
+    for (size_t i = 0; i < objects.size(); ++i) {
+        bool potentiallyVisible = !visibleSet || (visibleSet[i >> 3] & (1 << (i & 7)));
+        objects[i].cullHandle = potentiallyVisible ? culler->add(objects[i].bounds, glm::mat4(1.0f)) : -1;
+    }
+}
+
+void _staticBatch::draw(const _frustumCuller *culler)
+{
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    drawnObjects = 0;
+    for (size_t slot = 0; slot < batches.size(); ++slot)
+    {
+        const batch &b = batches[slot];
+        if (!b.vbo) continue;
+
+        // ---- Visible ranges of this batch, neighbours merged ----
+        drawCounts.clear();
+        drawOffsets.clear();
+        GLsizei runStart = 0, runEnd = -1;
+
+        for (const object &o : objects)
+        {
+            if (o.batch != (int)slot) continue;
+            if (culler && !culler->visible(o.cullHandle)) continue;
+            drawnObjects++;
+
+            if (o.firstIndex == runEnd) {
+                runEnd += o.indexCount;
+                continue;
+            }
+            if (runEnd >= 0) {
+                drawCounts.push_back(runEnd - runStart);
+                drawOffsets.push_back((const GLvoid *)(runStart * sizeof(unsigned int)));
+            }
+            runStart = o.firstIndex;
+            runEnd = o.firstIndex + o.indexCount;
+        }
+        if (runEnd >= 0) {
+            drawCounts.push_back(runEnd - runStart);
+            drawOffsets.push_back((const GLvoid *)(runStart * sizeof(unsigned int)));
+        }
+        if (drawCounts.empty()) continue;
+
+        if (b.textureID != 0) {
+            glEnable(GL_TEXTURE_2D);
+            _textureResidency::instance()->bind(b.textureID);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+        glVertexPointer(3, GL_FLOAT, 8 * sizeof(float), (void*)0);
+        glNormalPointer(GL_FLOAT, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glTexCoordPointer(2, GL_FLOAT, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+
+        // still one call per material, however the visible objects are scattered
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.ebo);
+        glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), (GLsizei)drawCounts.size());
+
+        if (b.textureID != 0) glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void _staticBatch::printStats()
+{
+    printf("Static batches: %d objects, %d triangles in %d draw calls\n",
+           objectCount, triangleCount, (int)batches.size());
+}
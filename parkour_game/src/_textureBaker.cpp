@@ -0,0 +1,318 @@
+#include "_textureBaker.h"
+#include <stdio.h>
+#include <sys/stat.h>
+
+// ---- 565 helpers ----
+static inline uint16_t pack565(int r, int g, int b)
+{
+    return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+static inline void unpack565(uint16_t c, int out[3])
+{
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+_textureBaker::_textureBaker()
+{
+    //ctor
+}
+
+_textureBaker::~_textureBaker()
+{
+    //dtor
+}
+
+std::string _textureBaker::bakedPath(const char* fileName)
+{
+    // keep the source extension: foo.png and foo.jpg must not share a bake
+    return std::string(fileName) + ".dds";
+}
+
+bool _textureBaker::bakeIsCurrent(const char* fileName)
+{
+    struct stat src, baked;
+    if (stat(bakedPath(fileName).c_str(), &baked) != 0) return false;
+    if (stat(fileName, &src) != 0) return true;             //shipped without the source
+    return baked.st_mtime >= src.st_mtime;
+}
+
+void _textureBaker::buildMip(const unsigned char* src, int w, int h, std::vector<unsigned char> &dst, int &outW, int &outH)
+{
+    outW = w > 1 ? w / 2 : 1;
+    outH = h > 1 ? h / 2 : 1;
+    dst.resize((size_t)outW * outH * 4);
+
+    // 2x2 box filter, clamped at the edge for odd sizes
+    for (int y = 0; y < outH; ++y)
+    {
+        int y0 = y * 2, y1 = (y * 2 + 1 < h) ? y * 2 + 1 : y0;
+        for (int x = 0; x < outW; ++x)
+        {
+            int x0 = x * 2, x1 = (x * 2 + 1 < w) ? x * 2 + 1 : x0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int sum = src[(y0 * w + x0) * 4 + c] + src[(y0 * w + x1) * 4 + c]
+                        + src[(y1 * w + x0) * 4 + c] + src[(y1 * w + x1) * 4 + c];
+                dst[(y * outW + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+void _textureBaker::encodeColorBlock(const unsigned char* block, unsigned char* out)
+{
+    // ---- Bounding box of the 16 colors, inset a little to cut rounding error ----
+    int mn[3] = {255, 255, 255}, mx[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c) {
+            if (block[i * 4 + c] < mn[c]) mn[c] = block[i * 4 + c];
+            if (block[i * 4 + c] > mx[c]) mx[c] = block[i * 4 + c];
+        }
+
+    // pick the box diagonal that follows the colors: flip a channel if it falls
+    // while the channel with the widest range rises
+    int axis = 0;
+    for (int c = 1; c < 3; ++c) if (mx[c] - mn[c] > mx[axis] - mn[axis]) axis = c;
+
+    int mean[3] = {(mn[0] + mx[0]) / 2, (mn[1] + mx[1]) / 2, (mn[2] + mx[2]) / 2};
+    int cov[3] = {0, 0, 0};
+    for (int i = 0; i < 16; ++i) {
+        int a = block[i * 4 + axis] - mean[axis];
+        for (int c = 0; c < 3; ++c) cov[c] += (block[i * 4 + c] - mean[c]) * a;
+    }
+    for (int c = 0; c < 3; ++c) {
+        if (cov[c] < 0) { int t = mn[c]; mn[c] = mx[c]; mx[c] = t; }
+    }
+
+    for (int c = 0; c < 3; ++c) {
+        int inset = (mx[c] - mn[c]) / 16;
+        mx[c] -= inset;
+        mn[c] += inset;
+    }
+
+    uint16_t c0 = pack565(mx[0], mx[1], mx[2]);
+    uint16_t c1 = pack565(mn[0], mn[1], mn[2]);
+    if (c0 < c1) { uint16_t t = c0; c0 = c1; c1 = t; }     //c0 > c1 selects 4-color mode
+
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+
+    uint32_t indices = 0;
+    if (c0 != c1)
+    {
+        int pal[4][3];
+        unpack565(c0, pal[0]);
+        unpack565(c1, pal[1]);
+        for (int c = 0; c < 3; ++c) {
+            pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+            pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 4; ++p) {
+                int dr = block[i * 4 + 0] - pal[p][0];
+                int dg = block[i * 4 + 1] - pal[p][1];
+                int db = block[i * 4 + 2] - pal[p][2];
+                int d = dr * dr + dg * dg + db * db;
+                if (d < bestDist) { bestDist = d; best = p; }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+
+    out[4] = indices & 0xff;
+    out[5] = (indices >> 8) & 0xff;
+    out[6] = (indices >> 16) & 0xff;
+    out[7] = (indices >> 24) & 0xff;
+}
+
+void _textureBaker::encodeAlphaBlock(const unsigned char* block, unsigned char* out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; ++i) {
+        if (block[i * 4 + 3] > a0) a0 = block[i * 4 + 3];
+        if (block[i * 4 + 3] < a1) a1 = block[i * 4 + 3];
+    }
+
+    out[0] = (unsigned char)a0;
+    out[1] = (unsigned char)a1;
+
+    // 8-alpha mode (a0 > a1): palette a0, a1 and six steps between them
+    int pal[8];
+    pal[0] = a0; pal[1] = a1;
+    for (int k = 1; k <= 6; ++k) pal[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+
+    uint64_t bits = 0;
+    if (a0 != a1)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            int best = 0, bestDist = 1 << 30;
+            for (int p = 0; p < 8; ++p) {
+                int d = abs(block[i * 4 + 3] - pal[p]);
+                if (d < bestDist) { bestDist = d; best = p; }
+            }
+            bits |= (uint64_t)best << (i * 3);
+        }
+    }
+
+    for (int b = 0; b < 6; ++b) out[2 + b] = (unsigned char)((bits >> (b * 8)) & 0xff);
+}
+
+void _textureBaker::compressLevel(const unsigned char* pixels, int w, int h, bool alpha, std::vector<unsigned char> &out)
+{
+    int bw = (w + 3) / 4, bh = (h + 3) / 4;
+    int blockBytes = alpha ? 16 : 8;
+    out.resize((size_t)bw * bh * blockBytes);
+
+    unsigned char block[64];
+    for (int by = 0; by < bh; ++by)
+        for (int bx = 0; bx < bw; ++bx)
+        {
+            // gather 4x4 texels, repeating the edge for partial blocks
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x) {
+                    int sx = bx * 4 + x; if (sx >= w) sx = w - 1;
+                    int sy = by * 4 + y; if (sy >= h) sy = h - 1;
+                    memcpy(&block[(y * 4 + x) * 4], &pixels[(sy * w + sx) * 4], 4);
+                }
+
+            unsigned char *dst = &out[((size_t)by * bw + bx) * blockBytes];
+            if (alpha) {
+                encodeAlphaBlock(block, dst);
+                encodeColorBlock(block, dst + 8);
+            }
+            else {
+                encodeColorBlock(block, dst);
+            }
+        }
+}
+
+bool _textureBaker::bakeFile(const char* srcName, const char* dstName, int format)
+{
+    int w, h;
+    unsigned char *image = SOIL_load_image(srcName, &w, &h, 0, SOIL_LOAD_RGBA);
+    if (!image) {
+        cout << "Bake: could not load " << srcName << endl;
+        return false;
+    }
+
+    if (format == AUTO) {
+        format = BC1;
+        for (int i = 0; i < w * h; ++i) {
+            if (image[i * 4 + 3] != 255) { format = BC3; break; }
+        }
+    }
+
+    // ---- Mip chain, level 0 down to 1x1 ----
+    std::vector<std::vector<unsigned char>> levels(1);
+    std::vector<int> widths(1, w), heights(1, h);
+    levels[0].assign(image, image + (size_t)w * h * 4);
+    SOIL_free_image_data(image);
+
+    while (widths.back() > 1 || heights.back() > 1) {
+        std::vector<unsigned char> next;
+        int nw, nh;
+        buildMip(levels.back().data(), widths.back(), heights.back(), next, nw, nh);
+        levels.push_back(next);
+        widths.push_back(nw);
+        heights.push_back(nh);
+    }
+
+    // ---- Header ----
+    dds_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.size = 124;
+    hdr.flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000;         //caps, height, width, pixelformat, mipmapcount
+    hdr.height = h;
+    hdr.width = w;
+    hdr.mipMapCount = (uint32_t)levels.size();
+    hdr.ddspf.size = 32;
+    hdr.caps = 0x8 | 0x1000 | 0x400000;                     //complex, texture, mipmap
+
+    if (format == RGBA8) {
+        hdr.flags |= 0x8;                                   //pitch
+        hdr.pitchOrLinearSize = w * 4;
+        hdr.ddspf.flags = 0x40 | 0x1;                       //rgb + alpha
+        hdr.ddspf.rgbBitCount = 32;
+        hdr.ddspf.rMask = 0x000000ff;
+        hdr.ddspf.gMask = 0x0000ff00;
+        hdr.ddspf.bMask = 0x00ff0000;
+        hdr.ddspf.aMask = 0xff000000;
+    }
+    else {
+        hdr.flags |= 0x80000;                               //linear size
+        hdr.pitchOrLinearSize = ((w + 3) / 4) * ((h + 3) / 4) * (format == BC3 ? 16 : 8);
+        hdr.ddspf.flags = 0x4;                              //fourcc
+        hdr.ddspf.fourCC = format == BC3 ? DDS_FOURCC_DXT5 : DDS_FOURCC_DXT1;
+    }
+
+    FILE *fp = fopen(dstName, "wb");
+    if (!fp) {
+        cout << "Bake: could not write " << dstName << endl;
+        return false;
+    }
+
+    uint32_t magic = DDS_MAGIC;
+    fwrite(&magic, 4, 1, fp);
+    fwrite(&hdr, sizeof(hdr), 1, fp);
+
+    long long written = 0;
+    for (size_t l = 0; l < levels.size(); ++l)
+    {
+        if (format == RGBA8) {
+            fwrite(levels[l].data(), 1, levels[l].size(), fp);
+            written += levels[l].size();
+        }
+        else {
+            std::vector<unsigned char> blocks;
+            compressLevel(levels[l].data(), widths[l], heights[l], format == BC3, blocks);
+            fwrite(blocks.data(), 1, blocks.size(), fp);
+            written += blocks.size();
+        }
+    }
+    fclose(fp);
+
+    sourceBytes += (long long)w * h * 4;
+    bakedBytes += written;
+
+    const char *names[] = {"RGBA8", "BC1", "BC3"};
+    printf("Bake: %s -> %s (%dx%d, %d mips, %s, %.1f KB)\n",
+           srcName, dstName, w, h, (int)levels.size(), names[format], written / 1024.0);
+    return true;
+}
+
+int _textureBaker::bakeDirectory(const char* dir, int format)
+{
+    int count = 0;
+    const char *patterns[] = {"*.jpg", "*.png"};
+
+    for (const char *pattern : patterns)
+    {
+        std::string search = std::string(dir) + "/" + pattern;
+
+        WIN32_FIND_DATAA found;
+        HANDLE h = FindFirstFileA(search.c_str(), &found);
+        if (h == INVALID_HANDLE_VALUE) continue;
+
+        do {
+            std::string src = std::string(dir) + "/" + found.cFileName;
+            if (bakeFile(src.c_str(), bakedPath(src.c_str()).c_str(), format)) count++;
+        } while (FindNextFileA(h, &found));
+
+        FindClose(h);
+    }
+
+    if (bakedBytes > 0) {
+        printf("Bake: %d files, %.2f MB RGBA8 -> %.2f MB baked (x%.1f smaller, mips included)\n",
+               count, sourceBytes / (1024.0 * 1024.0), bakedBytes / (1024.0 * 1024.0),
+               (double)sourceBytes / bakedBytes);
+    }
+    return count;
+}
@@ -0,0 +1,185 @@
+#include "_textureCache.h"
+#include "_textureResidency.h"
+#include <stdio.h>
+#include <ctype.h>
+
+_textureCache::_textureCache()
+{
+    //ctor
+}
+
+_textureCache::~_textureCache()
+{
+    //dtor
+}
+
+_textureCache* _textureCache::instance()
+{
+    static _textureCache cache;
+    return &cache;
+}
+
+std::string _textureCache::canonicalPath(const char* fileName)
+{
+    std::string path = fileName ? fileName : "";
+
+    // ---- Windows paths are case insensitive and accept either separator ----
+    for (char &c : path) {
+        if (c == '\\') c = '/';
+        c = (char)tolower((unsigned char)c);
+    }
+
+    // ---- Collapse "." and ".." segments ----
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= path.size())
+    {
+        size_t end = path.find('/', start);
+        if (end == std::string::npos) end = path.size();
+
+        std::string part = path.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") parts.pop_back();
+            else parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+
+    std::string out = (!path.empty() && path[0] == '/') ? "/" : "";
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i) out += '/';
+        out += parts[i];
+    }
+    return out;
+}
+
+unsigned long long _textureCache::hashBytes(const unsigned char* bytes, size_t size)
+{
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1;                               //0 is reserved for "no hash"
+}
+
+bool _textureCache::readFile(const char* fileName, std::vector<unsigned char> &bytes)
+{
+    FILE *fp = fopen(fileName, "rb");
+    if (!fp) return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    if (size <= 0) { fclose(fp); return false; }
+
+    bytes.resize((size_t)size);
+    size_t got = fread(bytes.data(), 1, bytes.size(), fp);
+    fclose(fp);
+
+    return got == bytes.size();
+}
+
+bool _textureCache::contains(const std::string &path, unsigned long long hash)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    if (!path.empty() && byPath.count(path)) return true;
+    if (hash && byHash.count(hash)) return true;
+    return false;
+}
+
+GLuint _textureCache::acquire(const std::string &path, unsigned long long hash, int *w, int *h)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    GLuint id = 0;
+
+    auto p = byPath.find(path);
+    if (p != byPath.end()) {
+        id = p->second;
+    }
+    else if (hash) {
+        auto c = byHash.find(hash);
+        if (c != byHash.end()) {
+            id = c->second;
+
+            // same pixels under a new name; remember the alias for next time
+            if (!path.empty()) {
+                byPath[path] = id;
+                entries[id].paths.push_back(path);
+            }
+        }
+    }
+
+    if (!id) return 0;
+
+    cacheEntry &e = entries[id];
+    e.refCount++;
+
+    hits++;
+    bytesSaved += e.bytes;
+
+    if (w) *w = e.width;
+    if (h) *h = e.height;
+    return id;
+}
+
+void _textureCache::insert(const std::string &path, unsigned long long hash, GLuint id, int w, int h, long long bytes)
+{
+    if (!id) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+
+    cacheEntry e;
+    e.id = id;
+    e.hash = hash;
+    e.width = w;
+    e.height = h;
+    e.bytes = bytes;
+    e.refCount = 1;
+    if (!path.empty()) e.paths.push_back(path);
+
+    entries[id] = e;
+    if (!path.empty()) byPath[path] = id;
+    if (hash) byHash[hash] = id;
+
+    misses++;
+    bytesResident += bytes;
+}
+
+void _textureCache::release(GLuint id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    auto it = entries.find(id);
+    if (it == entries.end()) return;
+
+    cacheEntry &e = it->second;
+    if (--e.refCount > 0) return;
+
+    // ---- Last owner gone: evict every alias and free the GL texture ----
+    for (const std::string &p : e.paths) byPath.erase(p);
+    if (e.hash) byHash.erase(e.hash);
+
+    bytesResident -= e.bytes;
+    _textureResidency::instance()->untrack(e.id);
+    _textureStreamer::cancel(e.id);                         //rows still queued must not land in a reused name
+    glDeleteTextures(1, &e.id);
+
+    entries.erase(it);
+}
+
+void _textureCache::printStats()
+{
+    std::lock_guard<std::mutex> guard(lock);
+
+    printf("---- Texture cache ----\n");
+    printf("hits %d, misses %d, unique %d\n", hits, misses, (int)entries.size());
+    printf("resident %.2f MB, VRAM saved %.2f MB\n",
+           bytesResident / (1024.0 * 1024.0), bytesSaved / (1024.0 * 1024.0));
+}
@@ -1,24 +1,84 @@
 #include "_textureLoader.h"
+#include "_textureBaker.h"
+#include <algorithm>
 
 _textureLoader::_textureLoader()
 {
     //ctor
+    image = nullptr;
+    width = height = 0;
+    residentBytes = 0;
+    textID = 0;                                         //binds as "no texture" until a load lands
 }
 
 _textureLoader::~_textureLoader()
 {
     //dtor
+    for (GLuint id : owned) _textureCache::instance()->release(id);
 }
 GLuint _textureLoader::loadTexture(char* fileName)
 {
-    glGenTextures(1, &textID);                          //create handle
-    glBindTexture(GL_TEXTURE_2D, textID);
+    std::string path = _textureCache::canonicalPath(fileName);
+
+    // ---- Already resident under this name ----
+    if (acquireCached(path, 0)) return textID;
+
+    std::vector<unsigned char> bytes;
+
+    // ---- Fast path: pre-baked mips (and S3TC blocks) sitting next to the source ----
+    if (_textureBaker::bakeIsCurrent(fileName) && _textureCache::readFile(_textureBaker::bakedPath(fileName).c_str(), bytes)) {
+        unsigned long long hash = _textureCache::hashBytes(bytes.data(), bytes.size());
+        if (acquireCached(path, hash)) return textID;
 
-    image = SOIL_load_image(fileName, &width, &height, 0, SOIL_LOAD_RGBA);
-    if(!image) cout << "Error : *****file did not load*****" << endl;
+        if (uploadDDS(bytes.data(), bytes.size())) {
+            addToCache(path, hash, fileName);
+            return textID;
+        }
+    }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    if (!_textureCache::readFile(fileName, bytes)) {
+        cout << "Error : *****file did not load*****" << endl;
+        textID = 0;
+        return textID;
+    }
+
+    // ---- Same pixels under a different name ----
+    unsigned long long hash = _textureCache::hashBytes(bytes.data(), bytes.size());
+    if (acquireCached(path, hash)) return textID;
+
+    image = decodeTexture(bytes.data(), (int)bytes.size(), &width, &height);
+    if (!image) {
+        textID = 0;
+        return textID;
+    }
+
+    uploadTexture(image, width, height);
     SOIL_free_image_data(image);
+    image = nullptr;
+
+    addToCache(path, hash, fileName);
+
+    return textID;
+}
+
+unsigned char* _textureLoader::decodeTexture(const unsigned char* bytes, int size, int* w, int* h)
+{
+    unsigned char* pixels = SOIL_load_image_from_memory(bytes, size, w, h, 0, SOIL_LOAD_RGBA);
+    if(!pixels) cout << "Error : *****file did not load*****" << endl;
+
+    return pixels;
+}
+
+GLuint _textureLoader::uploadTexture(unsigned char* pixels, int w, int h)
+{
+    width = w;
+    height = h;
+    residentBytes = (long long)w * h * 4;
+
+    glGenTextures(1, &textID);                          //create handle
+    glBindTexture(GL_TEXTURE_2D, textID);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -29,8 +89,145 @@ GLuint _textureLoader::loadTexture(char* fileName)
     return textID;
 }
 
+GLuint _textureLoader::streamTexture(unsigned char* pixels, int w, int h, _textureStreamer* streamer)
+{
+    width = w;
+    height = h;
+    residentBytes = (long long)w * h * 4;
+
+    textID = streamer->queueTexture(pixels, w, h);      //streamer frees pixels when done
+
+    return textID;
+}
+
+bool _textureLoader::uploadDDS(const unsigned char* bytes, size_t size)
+{
+    GLuint id;
+    glGenTextures(1, &id);
+
+    long long bytesUsed = 0;
+    int levels = specifyDDS(id, bytes, size, 0, &width, &height, &bytesUsed);
+    if (!levels) {
+        glDeleteTextures(1, &id);
+        return false;
+    }
+
+    textID = id;
+    residentBytes = bytesUsed;
+    return true;
+}
+
+int _textureLoader::specifyDDS(GLuint id, const unsigned char* bytes, size_t size, int skip, int* outW, int* outH, long long* outBytes)
+{
+    if (size < 4 + sizeof(dds_header_t)) return 0;
+    if (*(const uint32_t*)bytes != DDS_MAGIC) return 0;
+
+    dds_header_t hdr;
+    memcpy(&hdr, bytes + 4, sizeof(hdr));
+
+    // ---- Only the formats the baker writes ----
+    GLenum format = 0;
+    int blockBytes = 0;
+    if (hdr.ddspf.flags & 0x4) {
+        if (!GLEW_EXT_texture_compression_s3tc) return 0;          //decode the source instead
+        if (hdr.ddspf.fourCC == DDS_FOURCC_DXT1)      { format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; blockBytes = 8; }
+        else if (hdr.ddspf.fourCC == DDS_FOURCC_DXT5) { format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; blockBytes = 16; }
+        else return 0;
+    }
+    else if (hdr.ddspf.rgbBitCount != 32 || hdr.ddspf.rMask != 0x000000ff) {
+        return 0;
+    }
+
+    // ---- Reject the header before GL sees any of it: sizes, chain length, and every level inside the file ----
+    if (hdr.width < 1 || hdr.height < 1 || hdr.width > DDS_MAX_SIZE || hdr.height > DDS_MAX_SIZE) return 0;
+
+    int fileLevels = hdr.mipMapCount > 0 ? (int)hdr.mipMapCount : 1;
+    int longest = std::max(hdr.width, hdr.height), chain = 1;
+    while (longest >>= 1) chain++;
+    if (fileLevels > chain) return 0;                       //a chain past 1x1
+
+    size_t remaining = size - 4 - sizeof(dds_header_t);
+    int w = hdr.width, h = hdr.height;
+    for (int l = 0; l < fileLevels; ++l)
+    {
+        size_t levelSize = blockBytes ? (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes
+                                      : (size_t)w * h * 4;
+        if (levelSize > remaining) return 0;                //truncated, or more levels than the file holds
+        remaining -= levelSize;
+
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    if (skip > fileLevels - 1) skip = fileLevels - 1;
+
+    glBindTexture(GL_TEXTURE_2D, id);
+
+    const unsigned char *p = bytes + 4 + sizeof(dds_header_t);
+    w = hdr.width;
+    h = hdr.height;
+    int levels = 0;
+    long long total = 0;
+
+    // ---- Level "skip" of the file becomes level 0 of the texture ----
+    for (int l = 0; l < fileLevels; ++l)
+    {
+        size_t levelSize = blockBytes ? (size_t)((w + 3) / 4) * ((h + 3) / 4) * blockBytes
+                                      : (size_t)w * h * 4;
+
+        if (l >= skip) {
+            if (levels == 0) { *outW = w; *outH = h; }
+
+            if (blockBytes) glCompressedTexImage2D(GL_TEXTURE_2D, levels, format, w, h, 0, (GLsizei)levelSize, p);
+            else            glTexImage2D(GL_TEXTURE_2D, levels, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, p);
+
+            total += levelSize;
+            levels++;
+        }
+
+        p += levelSize;
+        w = w > 1 ? w / 2 : 1;
+        h = h > 1 ? h / 2 : 1;
+    }
+
+    if (!levels) return 0;
+
+    // free any levels left over from a bigger previous specification
+    for (int l = levels; l < 16; ++l) glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    if (outBytes) *outBytes = total;
+    return levels;
+}
+
+bool _textureLoader::acquireCached(const std::string& path, unsigned long long hash)
+{
+    GLuint id = _textureCache::instance()->acquire(path, hash, &width, &height);
+    if (!id) return false;
+
+    textID = id;
+    owned.push_back(id);
+    return true;
+}
+
+void _textureLoader::addToCache(const std::string& path, unsigned long long hash, const char* fileName)
+{
+    _textureCache::instance()->insert(path, hash, textID, width, height, residentBytes);
+    owned.push_back(textID);
+
+    // the residency manager reloads from fileName (or its baked .dds) after an eviction
+    _textureResidency::instance()->track(textID, fileName, residentBytes);
+}
+
 void _textureLoader::bindTexture()
 {
     glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, textID);
+    _textureResidency::instance()->bind(textID);
 }
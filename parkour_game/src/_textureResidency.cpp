@@ -0,0 +1,305 @@
+#include "_textureResidency.h"
+#include "_textureLoader.h"
+#include "_textureBaker.h"
+#include <stdio.h>
+#include <string.h>
+
+_textureResidency::_textureResidency()
+{
+    //ctor
+}
+
+_textureResidency::~_textureResidency()
+{
+    //dtor
+    delete workers;                                     //the streamer's GL objects went with the context
+}
+
+_textureResidency* _textureResidency::instance()
+{
+    static _textureResidency residency;
+    return &residency;
+}
+
+void _textureResidency::track(GLuint id, const char* source, long long bytes)
+{
+    if (!id || !source) return;
+
+    GLint w = 0, h = 0;
+    glBindTexture(GL_TEXTURE_2D, id);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+
+    residentTexture t;
+    t.id = id;
+    t.source = source;
+    t.fullBytes = bytes;
+    t.bytes = bytes;
+    t.width = w;
+    t.height = h;
+    t.dropped = 0;
+    t.evicted = false;
+    t.pinned = false;
+    t.reloading = false;
+    t.expectedBytes = bytes;
+    t.lastUsed = frame;
+    t.generation = ++generations;
+
+    untrack(id);                                        //id reuse after a delete
+    textures[id] = t;
+    residentBytes += bytes;
+}
+
+void _textureResidency::untrack(GLuint id)
+{
+    auto it = textures.find(id);
+    if (it == textures.end()) return;
+
+    residentBytes -= it->second.bytes;
+    if (it->second.reloading) pendingBytes -= it->second.expectedBytes - it->second.bytes;   //its result is dropped on arrival
+    textures.erase(it);
+}
+
+void _textureResidency::setPinned(GLuint id, bool pinned)
+{
+    auto it = textures.find(id);
+    if (it != textures.end()) it->second.pinned = pinned;
+}
+
+void _textureResidency::bind(GLuint id)
+{
+    glBindTexture(GL_TEXTURE_2D, id);
+
+    auto it = textures.find(id);
+    if (it == textures.end()) return;
+
+    residentTexture &t = it->second;
+    t.lastUsed = frame;
+    if (t.reloading) return;                            //what is bound now stays until it lands
+
+    // ---- Bring it back at full size if it was evicted, or if there is room again ----
+    if (t.evicted || (t.dropped > 0 && residentBytes + pendingBytes - t.bytes + t.fullBytes <= budgetBytes)) {
+        requestReload(t, 0);
+    }
+}
+
+void _textureResidency::beginFrame()
+{
+    frame++;
+    finishReloads();
+    enforceBudget();
+}
+
+void _textureResidency::enforceBudget()
+{
+    while (residentBytes + pendingBytes > budgetBytes)
+    {
+        // ---- Least recently bound texture not drawn this frame or the last ----
+        // (beginFrame() runs before anything is bound, so the last frame's set is the live one)
+        residentTexture *lru = nullptr;
+        for (auto &it : textures) {
+            residentTexture &t = it.second;
+            if (t.evicted || t.pinned || t.reloading || frame - t.lastUsed <= 1) continue;
+            if (!lru || t.lastUsed < lru->lastUsed) lru = &t;
+        }
+        if (!lru) break;                                //everything left is in use
+
+        int next = lru->dropped + 1;
+        bool canDrop = next <= maxDropLevels
+                    && (lru->width >> next) >= minDropSize
+                    && (lru->height >> next) >= minDropSize;
+
+        if (canDrop) requestReload(*lru, next);
+        else evict(*lru);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void _textureResidency::requestReload(residentTexture &t, int dropLevels)
+{
+    if (!asyncReloads) {
+        bool dropping = dropLevels > t.dropped && !t.evicted;
+        if (respecify(t, dropLevels)) dropping ? drops++ : reloads++;
+        else if (!t.evicted) evict(t);
+        return;
+    }
+
+    if (!workers) {
+        workers = new _threadPool(1);
+        streamer = new _textureStreamer();
+    }
+
+    // ---- Counted at its new size straight away, so the budget loop can move on ----
+    t.reloading = true;
+    t.expectedBytes = t.fullBytes >> (2 * dropLevels);  //each dropped level is a quarter of the size
+    pendingBytes += t.expectedBytes - t.bytes;
+
+    reloadResult *r = new reloadResult();
+    r->id = t.id;
+    r->generation = t.generation;
+    r->dropLevels = dropLevels;
+    r->pixels = nullptr;
+    r->width = r->height = 0;
+
+    std::string source = t.source;
+    workers->submit([this, r, source, dropLevels] {
+        prepareReload(r, source, dropLevels);
+
+        std::lock_guard<std::mutex> guard(finishedLock);
+        finished.push_back(r);
+    });
+}
+
+void _textureResidency::prepareReload(reloadResult *r, const std::string &source, int dropLevels)
+{
+    // ---- Baked mip chain: the upload just starts at the requested level ----
+    if (_textureBaker::bakeIsCurrent(source.c_str())
+        && _textureCache::readFile(_textureBaker::bakedPath(source.c_str()).c_str(), r->dds)) return;
+    r->dds.clear();
+
+    // ---- Source image: decode and box filter down ----
+    int w = 0, h = 0;
+    unsigned char *image = SOIL_load_image(source.c_str(), &w, &h, 0, SOIL_LOAD_RGBA);
+    if (!image) return;
+
+    if (dropLevels > 0) {
+        std::vector<unsigned char> level(image, image + (size_t)w * h * 4);
+        for (int l = 0; l < dropLevels; ++l) {
+            std::vector<unsigned char> next;
+            int nw, nh;
+            _textureBaker::buildMip(level.data(), w, h, next, nw, nh);
+            level.swap(next);
+            w = nw;
+            h = nh;
+        }
+        memcpy(image, level.data(), level.size());     //smaller, and the streamer frees SOIL buffers
+    }
+
+    r->pixels = image;
+    r->width = w;
+    r->height = h;
+}
+
+void _textureResidency::finishReloads()
+{
+    std::vector<reloadResult *> ready;
+    {
+        std::lock_guard<std::mutex> guard(finishedLock);
+        ready.swap(finished);
+    }
+
+    for (reloadResult *r : ready)
+    {
+        auto it = textures.find(r->id);
+        if (it != textures.end() && it->second.reloading && it->second.generation == r->generation)
+        {
+            residentTexture &t = it->second;
+            pendingBytes -= t.expectedBytes - t.bytes;
+            t.reloading = false;
+
+            bool dropping = r->dropLevels > t.dropped && !t.evicted;
+            long long bytes = 0;
+            int w = 0, h = 0;
+            bool ok = false;
+
+            // compressed levels go straight in; RGBA rows go through the PBO ring over the next frames
+            if (!r->dds.empty()) {
+                ok = _textureLoader::specifyDDS(t.id, r->dds.data(), r->dds.size(), r->dropLevels, &w, &h, &bytes) > 0;
+            }
+            else if (r->pixels) {
+                streamer->queueInto(t.id, r->pixels, r->width, r->height);
+                r->pixels = nullptr;                        //the streamer frees it
+                t.pinned = true;                            //unpinned by the streamer after the last row
+                bytes = (long long)r->width * r->height * 4;
+                ok = true;
+            }
+
+            if (ok) {
+                dropping ? drops++ : reloads++;
+                residentBytes += bytes - t.bytes;
+                t.bytes = bytes;
+                t.dropped = r->dropLevels;
+                t.evicted = false;
+            }
+            else if (!t.evicted) evict(t);
+        }
+
+        if (r->pixels) SOIL_free_image_data(r->pixels);
+        delete r;
+    }
+
+    if (streamer) streamer->update();
+}
+
+bool _textureResidency::respecify(residentTexture &t, int dropLevels)
+{
+    long long bytes = 0;
+    int w = 0, h = 0;
+
+    // ---- Baked mip chain: upload starting at the requested level ----
+    std::vector<unsigned char> file;
+    if (_textureBaker::bakeIsCurrent(t.source.c_str())
+        && _textureCache::readFile(_textureBaker::bakedPath(t.source.c_str()).c_str(), file)
+        && _textureLoader::specifyDDS(t.id, file.data(), file.size(), dropLevels, &w, &h, &bytes))
+    {
+        residentBytes += bytes - t.bytes;
+        t.bytes = bytes;
+        t.dropped = dropLevels;
+        t.evicted = false;
+        return true;
+    }
+
+    // ---- Source image: decode and box filter down ----
+    unsigned char *image = SOIL_load_image(t.source.c_str(), &w, &h, 0, SOIL_LOAD_RGBA);
+    if (!image) return false;
+
+    std::vector<unsigned char> level(image, image + (size_t)w * h * 4);
+    SOIL_free_image_data(image);
+
+    for (int l = 0; l < dropLevels; ++l) {
+        std::vector<unsigned char> next;
+        int nw, nh;
+        _textureBaker::buildMip(level.data(), w, h, next, nw, nh);
+        level.swap(next);
+        w = nw;
+        h = nh;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, t.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    bytes = (long long)w * h * 4;
+    residentBytes += bytes - t.bytes;
+    t.bytes = bytes;
+    t.dropped = dropLevels;
+    t.evicted = false;
+    return true;
+}
+
+void _textureResidency::evict(residentTexture &t)
+{
+    // keep the id alive with a 1x1 grey texel so existing handles stay valid
+    const unsigned char grey[4] = {128, 128, 128, 255};
+
+    glBindTexture(GL_TEXTURE_2D, t.id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    for (int l = 1; l < 16; ++l) glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    residentBytes += 4 - t.bytes;
+    t.bytes = 4;
+    t.evicted = true;
+    evictions++;
+}
+
+void _textureResidency::printStats()
+{
+    printf("---- Texture residency ----\n");
+    printf("resident %.2f / %.2f MB across %d textures\n",
+           residentBytes / (1024.0 * 1024.0), budgetBytes / (1024.0 * 1024.0), (int)textures.size());
+    printf("mip drops %d, evictions %d, reloads %d\n", drops, evictions, reloads);
+}
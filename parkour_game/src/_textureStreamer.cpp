@@ -0,0 +1,233 @@
+#include "_textureStreamer.h"
+#include "_textureResidency.h"
+#include <algorithm>
+
+_textureStreamer::_textureStreamer(int budgetBytes, int numBuffers)
+{
+    //ctor
+    bytesPerFrame = budgetBytes;
+    bytesQueued = 0;
+
+    bufferCount = numBuffers;
+    pbo = new GLuint[numBuffers];
+    for (int i = 0; i < numBuffers; ++i) pbo[i] = 0;
+    nextBuffer = 0;
+    usePBO = false;
+
+    live().push_back(this);
+}
+
+_textureStreamer::~_textureStreamer()
+{
+    //dtor
+    live().erase(std::remove(live().begin(), live().end(), this), live().end());
+
+    for (pendingUpload &up : queue) {
+        SOIL_free_image_data(up.pixels);
+        if (up.staging) glDeleteBuffers(1, &up.staging);
+    }
+
+    if (pbo[0]) glDeleteBuffers(bufferCount, pbo);
+    delete[] pbo;
+}
+
+void _textureStreamer::initBuffers()
+{
+    if (pbo[0]) return;
+
+    // fall back to plain glTexSubImage2D in budgeted slices if PBOs are missing
+    usePBO = GLEW_ARB_pixel_buffer_object || GLEW_VERSION_2_1;
+    if (usePBO) glGenBuffers(bufferCount, pbo);
+}
+
+static void setParameters()
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);       //a reused id may still carry a mip chain
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+GLuint _textureStreamer::queueTexture(unsigned char *pixels, int w, int h)
+{
+    initBuffers();
+
+    // ---- Allocate storage now so the id can be bound straight away ----
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    setParameters();
+
+    pendingUpload up;
+    up.tex = tex;
+    up.pixels = pixels;
+    up.width = w;
+    up.height = h;
+    up.nextRow = 0;
+    up.replace = false;
+    up.staging = 0;
+    queue.push_back(up);
+
+    bytesQueued += w * h * 4;
+    return tex;
+}
+
+void _textureStreamer::queueInto(GLuint tex, unsigned char *pixels, int w, int h)
+{
+    initBuffers();
+
+    // ---- Nothing touches the texture until every row is staged ----
+    pendingUpload up;
+    up.tex = tex;
+    up.pixels = pixels;
+    up.width = w;
+    up.height = h;
+    up.nextRow = 0;
+    up.replace = true;
+    up.staging = 0;
+    queue.push_back(up);
+
+    bytesQueued += w * h * 4;
+}
+
+std::vector<_textureStreamer *> &_textureStreamer::live()
+{
+    static std::vector<_textureStreamer *> streamers;
+    return streamers;
+}
+
+void _textureStreamer::cancel(GLuint tex)
+{
+    for (_textureStreamer *s : live()) s->drop(tex);
+}
+
+void _textureStreamer::drop(GLuint tex)
+{
+    for (auto it = queue.begin(); it != queue.end(); )
+    {
+        if (it->tex != tex) { ++it; continue; }
+
+        bytesQueued -= (it->height - it->nextRow) * it->width * 4;
+        SOIL_free_image_data(it->pixels);
+        if (it->staging) glDeleteBuffers(1, &it->staging);
+        it = queue.erase(it);
+    }
+}
+
+void _textureStreamer::update()
+{
+    int budget = bytesPerFrame;
+
+    while (!queue.empty() && budget > 0)
+    {
+        pendingUpload &up = queue.front();
+
+        int rowBytes = up.width * 4;
+        int rows = budget / rowBytes;
+        if (rows < 1) rows = 1;                             //always make progress on very wide images
+        if (rows > up.height - up.nextRow) rows = up.height - up.nextRow;
+
+        if (up.replace) stageRows(up, up.nextRow, rows);
+        else uploadRows(up, up.nextRow, rows);
+
+        up.nextRow += rows;
+        budget -= rows * rowBytes;
+        bytesQueued -= rows * rowBytes;
+
+        if (up.nextRow >= up.height) {
+            if (up.replace) finishReplace(up);
+            _textureResidency::instance()->setPinned(up.tex, false);
+            SOIL_free_image_data(up.pixels);
+            queue.pop_front();
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void _textureStreamer::uploadRows(pendingUpload &up, int firstRow, int rows)
+{
+    const unsigned char *src = up.pixels + (size_t)firstRow * up.width * 4;
+    int size = rows * up.width * 4;
+
+    glBindTexture(GL_TEXTURE_2D, up.tex);
+
+    if (!usePBO) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, up.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+        return;
+    }
+
+    // ---- Orphan the next buffer in the ring so we never wait on the driver ----
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[nextBuffer]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+    void *dst = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (dst) {
+        memcpy(dst, src, size);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        // offset 0 into the bound PBO; the copy to the texture happens asynchronously
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, up.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, up.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, src);
+    }
+
+    nextBuffer = (nextBuffer + 1) % bufferCount;
+}
+
+void _textureStreamer::stageRows(pendingUpload &up, int firstRow, int rows)
+{
+    // without PBOs the rows stay in client memory for finishReplace()
+    if (!usePBO) return;
+
+    if (!up.staging) {
+        glGenBuffers(1, &up.staging);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, up.staging);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (size_t)up.width * up.height * 4, NULL, GL_STREAM_DRAW);
+    }
+    else glBindBuffer(GL_PIXEL_UNPACK_BUFFER, up.staging);
+
+    size_t rowBytes = (size_t)up.width * 4;
+    glBufferSubData(GL_PIXEL_UNPACK_BUFFER, firstRow * rowBytes, rows * rowBytes, up.pixels + firstRow * rowBytes);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void _textureStreamer::finishReplace(pendingUpload &up)
+{
+    // ---- One call swaps the whole level; the copy out of the PBO is the driver's ----
+    glBindTexture(GL_TEXTURE_2D, up.tex);
+
+    if (up.staging) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, up.staging);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, up.width, up.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        glDeleteBuffers(1, &up.staging);
+        up.staging = 0;
+    }
+    else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, up.width, up.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, up.pixels);
+    }
+    setParameters();
+}
+
+bool _textureStreamer::isStreaming(GLuint tex)
+{
+    for (const pendingUpload &up : queue) {
+        if (up.tex == tex) return true;
+    }
+    return false;
+}
+
+bool _textureStreamer::isIdle()
+{
+    return queue.empty();
+}
@@ -0,0 +1,83 @@
+#include "_threadPool.h"
+
+static thread_local int currentWorker = -1;
+
+_threadPool::_threadPool(int numThreads)
+{
+    //ctor
+    if (numThreads <= 0) {
+        numThreads = (int)std::thread::hardware_concurrency() - 1;
+        if (numThreads < 1) numThreads = 1;
+    }
+
+    for (int i = 0; i < numThreads; ++i) {
+        workers.emplace_back(&_threadPool::workerLoop, this, i);
+    }
+}
+
+_threadPool::~_threadPool()
+{
+    //dtor
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    jobReady.notify_all();
+
+    for (std::thread& w : workers) {
+        if (w.joinable()) w.join();
+    }
+}
+
+void _threadPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs.push_back(std::move(job));
+        pending++;
+    }
+    jobReady.notify_one();
+}
+
+void _threadPool::waitAll()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    jobsDone.wait(guard, [this] { return pending == 0; });
+}
+
+int _threadPool::threadCount()
+{
+    return (int)workers.size();
+}
+
+int _threadPool::workerIndex()
+{
+    return currentWorker;
+}
+
+void _threadPool::workerLoop(int index)
+{
+    currentWorker = index;
+
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            jobReady.wait(guard, [this] { return stopping || !jobs.empty(); });
+
+            if (stopping && jobs.empty()) return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending--;
+            if (pending == 0) jobsDone.notify_all();
+        }
+    }
+}
@@ -1,28 +1,99 @@
 #include "gltfModel.h"
+#include "_animInstance.h"
+#include "_gpuInstancing.h"
+#include "_textureCache.h"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/type_ptr.hpp>
 
 
+GltfModel::~GltfModel()
+{
+    delete ownInstance;
+    for (_animClip* clip : clips) delete clip;
+
+    // textureID may have been replaced by a scene texture; only the embedded one is ours
+    if (embeddedTexture) _textureCache::instance()->release(embeddedTexture);
+}
+
 void GltfModel::setCgltfData(cgltf_data* d)
 {
     data = d;
     //ensureNodeTransformArrays();
 }
 
-void GltfModel::ensureNodeTransformArrays()
+void GltfModel::buildHierarchy()
 {
+    hierNode.clear();
+    hierParent.clear();
     if (!data) return;
+
+    // depth of each node; sorting by depth puts every parent before its children
     size_t n = static_cast<size_t>(data->nodes_count);
-    nodeLocalTransforms.assign(n, glm::mat4(1.0f));
-    nodeGlobalTransforms.assign(n, glm::mat4(1.0f));
+    std::vector<int> depth(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        for (const cgltf_node* p = data->nodes[i].parent; p; p = p->parent) depth[i]++;
+        hierNode.push_back((int)i);
+    }
+    std::stable_sort(hierNode.begin(), hierNode.end(), [&](int a, int b) { return depth[a] < depth[b]; });
+
+    for (int node : hierNode) {
+        const cgltf_node* parent = data->nodes[node].parent;
+        hierParent.push_back(parent ? (int)(parent - data->nodes) : -1);
+    }
 }
 
-glm::mat4 GltfModel::computeLocalMatrix(const cgltf_node* node) const
+// box over count vertices from first, sphere around the box centre
+static GltfModel::Bounds boundsOf(const std::vector<float>& xyz, size_t first, size_t count, const glm::vec3& pad)
 {
-    glm::mat4 m(1.0f);
+    GltfModel::Bounds b;
+    if (count == 0) return b;
+
+    b.min = b.max = glm::vec3(xyz[first * 3], xyz[first * 3 + 1], xyz[first * 3 + 2]);
+    for (size_t v = first; v < first + count; ++v) {
+        glm::vec3 p(xyz[v * 3], xyz[v * 3 + 1], xyz[v * 3 + 2]);
+        b.min = glm::min(b.min, p);
+        b.max = glm::max(b.max, p);
+    }
+    b.center = (b.min + b.max) * 0.5f;
+
+    float r2 = 0.0f;
+    for (size_t v = first; v < first + count; ++v) {
+        glm::vec3 d = glm::vec3(xyz[v * 3], xyz[v * 3 + 1], xyz[v * 3 + 2]) - b.center;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+
+    b.min -= pad;
+    b.max += pad;
+    b.radius = std::sqrt(r2) + glm::length(pad);
+    return b;
+}
 
-    if (!node) return m;
+void GltfModel::computeBounds()
+{
+    // every target at full weight at once is the furthest a vertex can move
+    glm::vec3 pad(0.0f);
+    for (const MorphTarget& t : morphTargets) {
+        glm::vec3 reach(0.0f);
+        for (size_t i = 0; i < t.dx.size(); ++i) {
+            reach = glm::max(reach, glm::abs(glm::vec3(t.dx[i], t.dy[i], t.dz[i])));
+        }
+        pad += reach;
+    }
+
+    size_t count = vertices.size() / 3;
+    bounds = boundsOf(vertices, 0, count, pad);
+
+    for (Submesh& sm : submeshes) {
+        sm.bounds = boundsOf(vertices, sm.firstVertex, sm.vertexCount, pad);
+    }
+}
+
+glm::mat4 GltfModel::computeLocalMatrix(size_t nodeIndex, const nodeTRS_t& p) const
+{
+    const cgltf_node* node = &data->nodes[nodeIndex];
 
     if (node->has_matrix) {
         // cgltf stores matrices in column-major order in node->matrix[16]
@@ -36,190 +107,84 @@ glm::mat4 GltfModel::computeLocalMatrix(const cgltf_node* node) const
         return mat;
     }
 
-    glm::vec3 T(0.0f);
-    glm::vec3 S(1.0f);
-    glm::quat R(1.0f, 0.0f, 0.0f, 0.0f); // w,x,y,z
-
-    if (node->has_translation) {
-        T = glm::vec3(node->translation[0], node->translation[1], node->translation[2]);
-    }
-    if (node->has_scale) {
-        S = glm::vec3(node->scale[0], node->scale[1], node->scale[2]);
-    }
-    if (node->has_rotation) {
-        // cgltf rotation is (x, y, z, w)
-        R = glm::quat(node->rotation[3], node->rotation[0], node->rotation[1], node->rotation[2]);
-    }
-
-    glm::mat4 trans = glm::translate(glm::mat4(1.0f), T);
-    glm::mat4 rot = glm::toMat4(R);
-    glm::mat4 scale = glm::scale(glm::mat4(1.0f), S);
+    // T * R * S written out directly: rotation columns scaled, translation in column 3
+    float x = p.rotation[0], y = p.rotation[1], z = p.rotation[2], w = p.rotation[3];
 
-    return trans * rot * scale;
+    glm::mat4 m(1.0f);
+    m[0][0] = (1.0f - 2.0f * (y * y + z * z)) * p.scale[0];
+    m[0][1] = (2.0f * (x * y + w * z)) * p.scale[0];
+    m[0][2] = (2.0f * (x * z - w * y)) * p.scale[0];
+
+    m[1][0] = (2.0f * (x * y - w * z)) * p.scale[1];
+    m[1][1] = (1.0f - 2.0f * (x * x + z * z)) * p.scale[1];
+    m[1][2] = (2.0f * (y * z + w * x)) * p.scale[1];
+
+    m[2][0] = (2.0f * (x * z + w * y)) * p.scale[2];
+    m[2][1] = (2.0f * (y * z - w * x)) * p.scale[2];
+    m[2][2] = (1.0f - 2.0f * (x * x + y * y)) * p.scale[2];
+
+    m[3][0] = p.translation[0];
+    m[3][1] = p.translation[1];
+    m[3][2] = p.translation[2];
+    return m;
 }
 
-void GltfModel::computeGlobalTransforms()
+void GltfModel::buildAnimationClips()
 {
+    for (_animClip* clip : clips) delete clip;
+    clips.clear();
     if (!data) return;
-    ensureNodeTransformArrays();
 
-    // build index map: node* -> index
-    std::unordered_map<const cgltf_node*, size_t> nodeIndex;
-    for (size_t i = 0; i < (size_t)data->nodes_count; ++i) {
-        nodeIndex[&data->nodes[i]] = i;
+    for (cgltf_size a = 0; a < data->animations_count; ++a) {
+        _animClip* clip = new _animClip();
+        clip->build(data, &data->animations[a], morphSlot);
+        clips.push_back(clip);
     }
 
-    // first fill local transforms from current cgltf nodes
+    // rest pose from the file; nodes without TRS keep identity
+    restPose.resize(data->nodes_count);
     for (size_t i = 0; i < (size_t)data->nodes_count; ++i) {
-        nodeLocalTransforms[i] = computeLocalMatrix(&data->nodes[i]);
-        nodeGlobalTransforms[i] = glm::mat4(1.0f); // reset
-    }
-
-    // recursive lambda to compute global from a node and its children
-    std::function<void(const cgltf_node*, const glm::mat4&)> recurse;
-    recurse = [&](const cgltf_node* node, const glm::mat4& parentMat) {
-        if (!node) return;
-        size_t idx = nodeIndex.at(node);
-        glm::mat4 local = nodeLocalTransforms[idx];
-        glm::mat4 global = parentMat * local;
-        nodeGlobalTransforms[idx] = global;
-
-        // cgltf node children iteration (if any)
-        for (cgltf_size i = 0; i < node->children_count; ++i) {
-            recurse(node->children[i], global);
-        }
-    };
-
-    // start at scene roots
-    for (cgltf_size s = 0; s < data->scenes_count; ++s) {
-        const cgltf_scene* scene = &data->scenes[s];
-        for (cgltf_size r = 0; r < scene->nodes_count; ++r) {
-            const cgltf_node* root = scene->nodes[r];
-            recurse(root, glm::mat4(1.0f));
+        const cgltf_node* node = &data->nodes[i];
+        nodeTRS_t& p = restPose[i];
+        for (int k = 0; k < 4; ++k) {
+            p.translation[k] = (k < 3 && node->has_translation) ? node->translation[k] : 0.0f;
+            p.rotation[k] = node->has_rotation ? node->rotation[k] : (k == 3 ? 1.0f : 0.0f);
+            p.scale[k] = (k < 3 && node->has_scale) ? node->scale[k] : 1.0f;
         }
     }
 }
 
-/* Helper readers: use cgltf_accessor_read_float (available in cgltf) */
-float GltfModel::readAccessorFloat(const cgltf_accessor* acc, size_t index) const
+void GltfModel::compressAnimationClips(float tolerance)
 {
-    if (!acc) return 0.0f;
-    float out = 0.0f;
-    cgltf_accessor_read_float(acc, index, &out, 1);
-    return out;
-}
-
-void GltfModel::readAccessorVec3(const cgltf_accessor* acc, size_t index, float out3[3]) const
-{
-    if (!acc) { out3[0] = out3[1] = out3[2] = 0.0f; return; }
-    cgltf_accessor_read_float(acc, index, out3, 3);
-}
-
-void GltfModel::readAccessorQuat(const cgltf_accessor* acc, size_t index, float out4[4]) const
-{
-    if (!acc) { out4[0] = out4[1] = out4[2] = out4[3] = 0.0f; return; }
-    cgltf_accessor_read_float(acc, index, out4, 4);
+    // instances keep their cursors; track count and order do not change
+    for (_animClip* clip : clips) {
+        size_t before = clip->byteSize();
+        int keysBefore = clip->keyCount();
+        if (!clip->compress(tolerance)) continue;
+
+        size_t after = clip->byteSize();
+        std::cout << "Clip '" << clip->name << "': " << keysBefore << " -> " << clip->keyCount() << " keys, "
+                  << before << " -> " << after << " bytes (" << (after ? (float)before / after : 0.0f) << ":1), max error "
+                  << clip->maxError << "\n";
+    }
 }
 
-void GltfModel::applyAnimationToNodes(float timeInSeconds)
+void GltfModel::updateAnimation(float timeInSeconds)
 {
-    if (!data || data->animations_count == 0) return;
-
-    // use the first animation for now
-    cgltf_animation* anim = &data->animations[0];
-
-    for (cgltf_size ch = 0; ch < anim->channels_count; ++ch) {
-        const cgltf_animation_channel* channel = &anim->channels[ch];
-        const cgltf_animation_sampler* sampler = channel->sampler;
-        const cgltf_accessor* input = sampler->input;
-        const cgltf_accessor* output = sampler->output;
-
-        if (!input || !output) continue;
-        if (input->count == 0) continue;
-
-        // find keyframe interval [k0, k1] such that t in [t0,t1]
-        size_t k0 = 0, k1 = 0;
-        float t0 = readAccessorFloat(input, 0);
-        if (timeInSeconds <= t0) {
-            k0 = k1 = 0;
-        } else {
-            // default to last
-            k1 = static_cast<size_t>(input->count - 1);
-            for (size_t k = 0; k < (size_t)input->count - 1; ++k) {
-                float ta = readAccessorFloat(input, k);
-                float tb = readAccessorFloat(input, k + 1);
-                if (timeInSeconds >= ta && timeInSeconds <= tb) {
-                    k0 = k;
-                    k1 = k + 1;
-                    break;
-                }
-            }
-        }
+    if (clips.empty()) return;
 
-        float ta = readAccessorFloat(input, k0);
-        float tb = readAccessorFloat(input, k1);
-        float factor = 0.0f;
-        if (k0 == k1) factor = 0.0f;
-        else factor = (timeInSeconds - ta) / (tb - ta);
-
-        // apply to node target
-        cgltf_node* target = channel->target_node;
-        if (!target) continue;
-
-        if (channel->target_path == cgltf_animation_path_type_translation) {
-            float v0[3], v1[3];
-            readAccessorVec3(output, k0, v0);
-            readAccessorVec3(output, k1, v1);
-            float vx = v0[0] + (v1[0] - v0[0]) * factor;
-            float vy = v0[1] + (v1[1] - v0[1]) * factor;
-            float vz = v0[2] + (v1[2] - v0[2]) * factor;
-            target->translation[0] = vx;
-            target->translation[1] = vy;
-            target->translation[2] = vz;
-            target->has_translation = 1;
-        }
-        else if (channel->target_path == cgltf_animation_path_type_scale) {
-            float v0[3], v1[3];
-            readAccessorVec3(output, k0, v0);
-            readAccessorVec3(output, k1, v1);
-            float sx = v0[0] + (v1[0] - v0[0]) * factor;
-            float sy = v0[1] + (v1[1] - v0[1]) * factor;
-            float sz = v0[2] + (v1[2] - v0[2]) * factor;
-            target->scale[0] = sx;
-            target->scale[1] = sy;
-            target->scale[2] = sz;
-            target->has_scale = 1;
-        }
-        else if (channel->target_path == cgltf_animation_path_type_rotation) {
-            float q0[4], q1[4];
-            readAccessorQuat(output, k0, q0);
-            readAccessorQuat(output, k1, q1);
-            // cgltf stores quat as x,y,z,w
-            glm::quat A(q0[3], q0[0], q0[1], q0[2]);
-            glm::quat B(q1[3], q1[0], q1[1], q1[2]);
-            glm::quat M = glm::slerp(A, B, factor);
-            // write back as x,y,z,w
-            target->rotation[0] = M.x;
-            target->rotation[1] = M.y;
-            target->rotation[2] = M.z;
-            target->rotation[3] = M.w;
-            target->has_rotation = 1;
-        }
+    if (!ownInstance) {
+        ownInstance = new _animInstance(this);
+        ownInstance->play(0, false);                        // hold the last key, as before
     }
+    ownInstance->setTime(timeInSeconds);
+    ownInstance->update(0.0f);
 }
 
-void GltfModel::updateAnimation(float timeInSeconds)
+const glm::mat4* GltfModel::rootTransform() const
 {
-    if (!data) return;
-    if (data->animations_count == 0) return;
-
-    // apply animation keyframes to nodes
-    applyAnimationToNodes(timeInSeconds);
-
-    // recompute local and global matrices
-    computeGlobalTransforms();
-
-    // (note) we do not skin vertices here, but you can use nodeGlobalTransforms + inverseBindMatrices later
+    if (!ownInstance || ownInstance->nodeGlobalTransforms.empty()) return nullptr;
+    return &ownInstance->nodeGlobalTransforms[0];
 }
 
 void GltfModel::uploadToGPU() {
@@ -244,6 +209,17 @@ void GltfModel::uploadToGPU() {
         glBufferData(GL_ARRAY_BUFFER, texcoords.size() * sizeof(float), texcoords.data(), GL_STATIC_DRAW);
     }
 
+    // --- JOINTS / WEIGHTS (vertex-shader skinning) ---
+    if (isSkinned()) {
+        glGenBuffers(1, &jbo);
+        glBindBuffer(GL_ARRAY_BUFFER, jbo);
+        glBufferData(GL_ARRAY_BUFFER, joints.size() * sizeof(unsigned short), joints.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &wbo);
+        glBindBuffer(GL_ARRAY_BUFFER, wbo);
+        glBufferData(GL_ARRAY_BUFFER, weights.size() * sizeof(float), weights.data(), GL_STATIC_DRAW);
+    }
+
     // --- INDICES ---
     if (!indices.empty()) {
         glGenBuffers(1, &ebo);
@@ -258,7 +234,7 @@ void GltfModel::draw() {
     // Bind texture if available
     if (textureID != 0) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        _textureResidency::instance()->bind(textureID);
     }
 
     // --- VERTICES ---
@@ -308,26 +284,42 @@ void GltfModel::draw() {
 void GltfModel::draw() {
     if (!data) return;
 
+    glPushMatrix();
+    // Apply root node transform only
+    if (const glm::mat4* root = rootTransform()) {
+        glMultMatrixf(glm::value_ptr(*root));
+    }
+
+    drawGeometry();
+
+    glPopMatrix();
+}
+
+void GltfModel::drawGeometry(GLuint skinnedVBO, GLsizei instances) {
+    if (!data) return;
+
     // Bind texture if available
     if (textureID != 0) {
         glEnable(GL_TEXTURE_2D);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-    }
-
-    glPushMatrix();
-    // Apply root node transform only
-    if (!nodeGlobalTransforms.empty()) {
-        glMultMatrixf(glm::value_ptr(nodeGlobalTransforms[0]));
+        _textureResidency::instance()->bind(textureID);
     }
 
     // Draw all vertices
-    if (vbo != 0) {
+    if (skinnedVBO != 0) {
+        // interleaved x,y,z,1, nx,ny,nz,0 written by the CPU skinning pass
+        glBindBuffer(GL_ARRAY_BUFFER, skinnedVBO);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 8 * sizeof(float), (void*)0);
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+    }
+    else if (vbo != 0) {
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
         glEnableClientState(GL_VERTEX_ARRAY);
         glVertexPointer(3, GL_FLOAT, 0, (void*)0);
     }
 
-    if (nbo != 0) {
+    if (nbo != 0 && skinnedVBO == 0) {
         glBindBuffer(GL_ARRAY_BUFFER, nbo);
         glEnableClientState(GL_NORMAL_ARRAY);
         glNormalPointer(GL_FLOAT, 0, (void*)0);
@@ -339,24 +331,45 @@ void GltfModel::draw() {
         glTexCoordPointer(2, GL_FLOAT, 0, (void*)0);
     }
 
-    if (ebo != 0 && !indices.empty()) {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
+    // per-instance attributes are already bound by _gpuInstancing
+    const void* first = ebo != 0 ? (const void*)0 : (const void*)indices.data();
+    if (ebo != 0) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    if (!indices.empty() && instances != 1) {
+        glDrawElementsInstancedARB(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, first, instances);
     } else if (!indices.empty()) {
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, indices.data());
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, first);
     }
 
-    if (vbo != 0) glDisableClientState(GL_VERTEX_ARRAY);
-    if (nbo != 0) glDisableClientState(GL_NORMAL_ARRAY);
+    if (vbo != 0 || skinnedVBO != 0) glDisableClientState(GL_VERTEX_ARRAY);
+    if (nbo != 0 || skinnedVBO != 0) glDisableClientState(GL_NORMAL_ARRAY);
     if (tbo != 0) glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 
-    glPopMatrix();
-
     if (textureID != 0) {
         glBindTexture(GL_TEXTURE_2D, 0);
     }
 }
 
+void GltfModel::drawInstanced(const std::vector<glm::mat4>& matrices, const std::vector<glm::vec4>& colors) {
+    if (!data || matrices.empty()) return;
+
+    if (_gpuInstancing::instance()->canDraw(this)) {
+        _gpuInstancing::instance()->draw(this, matrices, colors);
+        return;
+    }
+
+    // no instanced arrays on this context: same result, one draw per copy
+    for (size_t i = 0; i < matrices.size(); ++i) {
+        glm::vec4 c = i < colors.size() ? colors[i] : glm::vec4(1.0f);
+        glColor4fv(glm::value_ptr(c));
+
+        glPushMatrix();
+        glMultMatrixf(glm::value_ptr(matrices[i]));
+        draw();
+        glPopMatrix();
+    }
+}
+
 void GltfModel::buildTriangleList()
 {
     triangles.clear();